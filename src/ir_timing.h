@@ -0,0 +1,49 @@
+/********************************************************************************
+*               IR timing rules for the NEC decoder                             *
+*                                                                               *
+*   Shared by the firmware (NECDecoder) and the host side tools, so a capture   *
+*   decoded on the PC is judged with exactly the same limits as the fan.        *
+*                                                                               *
+*********************************************************************************/
+
+// Timer 1 is the time base, IR_CLOCK is its count rate: 125 kHz (8 us) with a 4 MHz clock and
+// the 1:8 prescaler, main.c derives it from _XTAL_FREQ. The NEC physical bit time is 560us.
+// The times are given in us, with a +/- 20% tolerance, and converted to Timer 1 counts
+
+#if !defined IR_CLOCK
+#define IR_CLOCK            125000L         // Timer 1 counts a second, 4MHz clock with 1:8 prescaler
+#endif
+#define IR_TIME(us)         (((us) * (IR_CLOCK / 1000) + 500) / 1000)
+
+#define IR_MARK_MIN_TIME    IR_TIME(6296)
+#define IR_SPACE_MIN_TIME   IR_TIME(1752)
+#define MIN_IR_BIT_TIME     IR_TIME(448)
+#define MAX_IR_BIT_TIME     IR_TIME(672)
+#define IR_IDLE_TIME        IR_TIME(16384)  // A gap this long (16 ms) restarts the decoder
+
+#if IR_IDLE_TIME > 0xFFFF
+#error "IR_CLOCK too high, the IR times do not fit Timer 1"
+#endif
+
+// Pulse classes, every edge interval is classified once and the class is shared by all the
+// protocol decoders. These are the upper limits of each class, chosen so that the NEC decisions
+// are the same as comparing the times; RC5 half bit is 889us, SIRC unit 600us and header 2.4ms
+
+#define PULSE_560_MAX       MAX_IR_BIT_TIME             // 448 - 672us, NEC/Samsung bit, SIRC unit
+#define PULSE_890_MAX       IR_TIME(1032)               // - 1032us, RC5 half bit
+#define PULSE_1200_MAX      (MIN_IR_BIT_TIME * 3 - 1)   // - 1336us, SIRC one
+#define PULSE_1690_MAX      (IR_SPACE_MIN_TIME - 1)     // - 1744us, NEC one, RC5 full bit
+#define PULSE_2000_MAX      (MAX_IR_BIT_TIME * 3)       // - 2016us, NEC one or a short NEC repeat space
+#define PULSE_2250_MAX      (IR_SPACE_MIN_TIME * 2 - 1) // - 3496us, NEC repeat space, SIRC header
+#define PULSE_4500_MAX      (IR_MARK_MIN_TIME - 1)      // - 6288us, NEC space, Samsung mark and space
+
+// Mark to mark periods, for the INT capture where only the start of a mark is timed; a zero
+// (1.12 ms) is PULSE_1200 and a one (2.25 ms) PULSE_2250, with their own +/- 20% limits (main.c
+// sets the classes to them)
+
+#define PERIOD_1120_MIN     IR_TIME(896)                // 896 - 1344us, NEC zero
+#define PERIOD_1120_MAX     IR_TIME(1344)
+#define PERIOD_2250_MIN     IR_TIME(1800)               // 1800 - 2700us, NEC one
+#define PERIOD_2250_MAX     IR_TIME(2700)
+#define PULSE_9000_MAX      IR_TIME(10120)              // - 10.1 ms
+#define PULSE_11250_MAX     IR_TIME(12368)              // - 12.4 ms, NEC repeat; above is a header (13.5 ms)
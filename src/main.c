@@ -34,42 +34,182 @@
 #include "type_def.h"
 #include "remote_commands.h"
 
+// -- Clock, all the timing below is derived from it; may be given on the command line --
+#if !defined _XTAL_FREQ
+#if defined _16F676
+#define _XTAL_FREQ      20000000        // External clock on CLKIN (GP5), the TRIAC moves to RC0
+#else
+#define _XTAL_FREQ      4000000         // Internal oscillator
+#endif
+#endif
+
 #if defined _12F675
+#if _XTAL_FREQ != 4000000
+#error "The 12F675 runs on the internal 4 MHz oscillator, CLKIN is the TRIAC pin"
+#endif
 __CONFIG(WDTDIS & MCLRDIS & INTIO & BORDIS & UNPROTECT & PWRTEN);
 __IDLOC7('0','.','7','B');
 #endif
 
-#if defined _16F676
-__CONFIG(WDTDIS & MCLREN & INTOSCIO & BORDIS & UNPROTECT & PWRTEN);
+#if defined _16F676                                     // RA3 (MCLR) is GP3, the IR input or with IR_CAPTURE_INT
+#if _XTAL_FREQ == 4000000                               // the down switch, so no reset pin
+__CONFIG(WDTDIS & MCLRDIS & INTOSCIO & BORDIS & UNPROTECT & PWRTEN);
+#else
+__CONFIG(WDTDIS & MCLRDIS & EXTCLK & BORDIS & UNPROTECT & PWRTEN);
+#endif
 #endif
 __EEPROM_DATA(5, 1, 1, 255, 255, 255, 255, 255);
 
 #define TIMER_ENABLE                    // Enable timer
+#if !defined NO_USAGE_COUNTERS
+#define USAGE_COUNTERS                  // Keep usage counters in the eeprom (usage.h), blinked out by CH
+#endif
+//#define LOAD_PROFILE    LOAD_CEILING    // Speed table for a load class from stable.h, the hand tuned one if not defined
+//#define BURST_FIRE      3               // Speeds 1 to 3 in whole mains cycles (burst), the rest on the phase angle
 // -- Chip Configurations --
-#define _XTAL_FREQ      4000000
-#define TRIAC           GPIO5           // Triac pin
+#if !defined MAINS_FREQ
+#define MAINS_FREQ      50              // Hz
+#endif
 #define ZC_PIN_MASK     0x10            // Pin used for zero cross detection
-#define IR_PIN_MASK     0x08            // IR sensor output
-#define TIME_COUNT      6866            // Number of Timer1 overflows in an hour
+#define SW_UP_MASK      0x01            // Up switch
+
+// -- Timing --
+// TMR0 times the firing delay from the zero cross, with the smallest prescaler that spans a
+// mains half cycle in 8 bits (1:64 at 4 MHz, 1:256 at 20 MHz). Timer 1 (1:8) is the IR time
+// base; its overflows (524 ms at 4 MHz) are counted down to a ~0.5 s tick for the timer, the
+// EEPROM update and the IR repeat.
+#define FCY             (_XTAL_FREQ / 4)                // Instruction cycles a second
+#define HALF_CYCLE      (FCY / (2 * MAINS_FREQ))        // Instruction cycles in a half cycle
+#if HALF_CYCLE / 2 < 256
+#define T0_PS           0                               // OPTION prescaler bits, 1:2
+#elif HALF_CYCLE / 4 < 256
+#define T0_PS           1
+#elif HALF_CYCLE / 8 < 256
+#define T0_PS           2
+#elif HALF_CYCLE / 16 < 256
+#define T0_PS           3
+#elif HALF_CYCLE / 32 < 256
+#define T0_PS           4
+#elif HALF_CYCLE / 64 < 256
+#define T0_PS           5
+#elif HALF_CYCLE / 128 < 256
+#define T0_PS           6
+#elif HALF_CYCLE / 256 < 256
+#define T0_PS           7
+#else
+#error "A mains half cycle does not fit TMR0"
+#endif
+#define T0_PRESCALE     (2 << T0_PS)
+#define OPTION_INIT     T0_PS                           // INT falling edge, pull ups, TMR0 prescaler
+#define PHASE_STEPS(us) (((us) * (FCY / 1000) / 1000 + T0_PRESCALE / 2) / T0_PRESCALE)  // TMR0 counts
+#define PHASE_ANGLE(us) (256 - PHASE_STEPS(us))
+#define GATE_US         7                               // TRIAC gate pulse of the TMR0 interrupt, tools/stable.c
+#define GATE_DELAY      (GATE_US * (FCY / 1000) / 1000 - 3)   // Cycles besides T0IF = 0 and the port writes
+
+#define T1CON_INIT      0x31                            // Prescaler 1:8, internal clk, TMR1ON
+#define IR_CLOCK        (FCY / 8)                       // Timer 1 counts a second
+#define T1_OVERFLOW     (65536L * 8)                    // Instruction cycles in a Timer 1 overflow
+#define T1_POSTSCALE    ((FCY / 2 + T1_OVERFLOW / 2) / T1_OVERFLOW)         // Overflows in a tick
+#define T1_TICK         (T1_OVERFLOW * T1_POSTSCALE)    // Instruction cycles in a tick
+#define TIME_COUNT      (3600L * (FCY / 64) / (T1_TICK / 64))               // Ticks in an hour
+#define EE_WRITE_COUNT  ((4L * FCY + T1_TICK / 2) / T1_TICK)                // Ticks in 4 seconds
+#if T1_POSTSCALE < 1 || T1_POSTSCALE > 255
+#error "No Timer 1 tick for this clock"
+#endif
+#if TIME_COUNT > 0xFFFF
+#error "TIME_COUNT does not fit TimeCounter"
+#endif
+#define USAGE_MINUTE    ((60L * (FCY / 64) + T1_TICK / 128) / (T1_TICK / 64))   // Ticks in a minute
+#if EE_WRITE_COUNT > 254
+#error "EE_WRITE_COUNT does not fit EECounter"
+#endif
+#if USAGE_MINUTE > 160
+#error "USAGE_MINUTE does not fit UsageTicks"
+#endif
+#include "ir_timing.h"
+#include "usage.h"
+
+#if defined USAGE_COUNTERS
+__EEPROM_DATA(0, 0, 0, 0, 0, 0, 0, 0);                 // Usage counters from EE_RUN_MINUTES
+__EEPROM_DATA(0, 0, 0, 0, 0, 0, 0, 0);
+__EEPROM_DATA(0, 0, 0, 0, 0, 0, 0, 0);
+__EEPROM_DATA(0, 0, 0, 0, 0, 0, 0, 0);
+__EEPROM_DATA(0, 0, 0, 0, 0, 0, 0, USAGE_VERSION);
+#endif
 
+// -- Burst fire --
+// The low speeds fire late in every half cycle, a TMR0 interrupt each and the most noise and
+// hum. With BURST_FIRE the speeds up to it conduct whole mains cycles instead: the zero cross
+// branch of isr() steps a first order sigma-delta (Bresenham) with the density of BTable at the
+// start of each cycle, and holds the gate through the cycles it picks; TMR0 does not interrupt.
+// Whole cycles keep DC off the load, the inertia of the fan evens out the pattern (a lamp on
+// the same mains may flicker with it, tools/sim reports the power and the gaps per speed)
+#if defined BURST_FIRE && (BURST_FIRE < 1 || BURST_FIRE > 8)
+#error "BURST_FIRE is the highest burst fired speed, 1 to 8"
+#endif
+#define BURST_POWER(pc) (((pc) * 256 + 50) / 100)     // Density for a power in %, mains cycles in 256
+
+// -- IR capture --
+// By default every IR edge interrupts (IOC on GP3), 67+ interrupts for a NEC frame. With
+// IR_CAPTURE_INT the IR sensor is wired to GP2/INT and only the start of each mark interrupts,
+// one per bit; the bits are decoded from the mark to mark time. The down switch moves to GP3,
+// which needs an external pull up. NEC only. (The TMR1 gate can not be used, T1G is the zero
+// cross input and Timer 1 is the time base for the timer)
+//#define IR_CAPTURE_INT
+#if defined IR_CAPTURE_INT
+#define IR_PIN_MASK     0x04            // IR sensor output, INT on falling edge
+#define SW_DN_MASK      0x08            // Down switch
+#define IOC_MASK        ZC_PIN_MASK
+#define INTCON_INIT     0x78            // Enable PEIE, Timer0, INT, Port change interrupts
+#define IsIRDataBitHigh()   GPIO2 == 0  // Inverted logic
+#define SW_DN           _GPIO,3
+#undef PULSE_890_MAX                    // The bit periods, +/- 20% as the times: a zero from 896us
+#define PULSE_890_MAX   (PERIOD_1120_MIN - 1)
+#undef PULSE_1200_MAX
+#define PULSE_1200_MAX  PERIOD_1120_MAX
+#undef PULSE_2000_MAX                   // and a one from 1800us
+#define PULSE_2000_MAX  (PERIOD_2250_MIN - 1)
+#undef PULSE_2250_MAX
+#define PULSE_2250_MAX  PERIOD_2250_MAX
+#else
+#define IR_PIN_MASK     0x08            // IR sensor output
+#define SW_DN_MASK      0x04            // Down switch
+#define IOC_MASK        (ZC_PIN_MASK | IR_PIN_MASK)
+#define INTCON_INIT     0x68            // Enable PEIE, Timer0, Port change interrupts
 #define IsIRDataBitHigh()   GPIO3 == 0  // Inverted logic
-#define SW_UP           _GPIO,0         // Up switch
 #define SW_DN           _GPIO,2         // Down switch
-#define ANY_KEY         Key & 0x80
-#define UP_KEY          Key & 0x01
-#define DN_KEY          Key & 0x02
+#endif
+
+// -- IR protocols, each decoder adds to the flash, enable only what fits --
+#define IR_NEC                          // NEC, the remote in remote_commands.h
+//#define IR_SAMSUNG                    // Samsung 32 bit, runs on the NEC decoder
+//#define IR_RC5                        // Philips RC5
+//#define IR_SIRC                       // Sony SIRC, 12 bit
+#define SAMSUNG_ADDRESS 0x07            // Device addresses accepted (TV)
+#define RC5_ADDRESS     0x00
+#define SIRC_ADDRESS    0x01
+#if defined IR_CAPTURE_INT && (defined IR_SAMSUNG || defined IR_RC5 || defined IR_SIRC)
+#error "IR_CAPTURE_INT decodes NEC only"
+#endif
+#if defined IR_NEC && !defined IR_SAMSUNG && !defined IR_RC5 && !defined IR_SIRC
+#define IR_NEC_ONLY                     // NECDecoder() compares the times itself, no pulse classes
+#endif
+
+#define SW_UP           _GPIO,0         // Up switch
+#define ANY_KEY         (Key & 0x80)
+#define UP_KEY          (Key & 0x01)
+#define DN_KEY          (Key & 0x02)
 #define LEDOn()         GPIO1 = 1       // LED
 #define LEDOff()        GPIO1 = 0
+#if defined _16F676 && _XTAL_FREQ != 4000000
+#define TRIAC           RC0             // Triac pin, GP5 is CLKIN
+#define TriacOn()       RC0 = 0
+#define TriacOff()      RC0 = 1
+#else
+#define TRIAC           GPIO5           // Triac pin
 #define TriacOn()       GPIO5 = 0       // Triac
 #define TriacOff()      GPIO5 = 1
-
-// Timer 1 is the time base, 1 bit time = 8us; the NEC physical bit time is 560us = 70 Timer 1
-// The following time are set with a +/- 20% tolerance
-
-#define IR_MARK_MIN_TIME    787
-#define IR_SPACE_MIN_TIME   219
-#define MIN_IR_BIT_TIME     56
-#define MAX_IR_BIT_TIME     84
+#endif
 
 // -- End of Chip Configurations --
 
@@ -84,10 +224,33 @@ __EEPROM_DATA(5, 1, 1, 255, 255, 255, 255, 255);
 #define EETimeUpdate    Flag1.b0        // Indicate to update time in eeprom
 #define IR05Seconds     Flag1.b1        // A 0.5 seconds of IR inactivity, used to clear IR command repeate flag
 #define ClearLED        Flag1.b2        // Need to turn off LED
+#define IRSamsung       Flag1.b3        // The frame in the NEC decoder is a Samsung one
+#define IRBurst         Flag1.b4        // A RC5/SIRC/Samsung frame received, cleared on 0.5 seconds of IR inactivity
+#define EEWritten       Flag1.b5        // The eeprom is written, the usage counters may go along
+#define BurstOn         Flag1.b6        // The mains cycle is burst fired, the gate held
+#define UsageSaved      Flag1.b7        // The counter flush goes with a settings write, counted in EE_WRITES
 
 #define FanOn           Status.b0       // Fan Running
 #define TimerRunning    Status.b1       // Timer Running
 
+#if PULSE_2000_MAX < 0x100
+#define IRShort(t)      (unsigned char)(t)  // The short pulse classes fit a byte, compare only the LSB
+#else
+#define IRShort(t)      (unsigned short)(t)
+#endif
+#define IRLong(t)       (unsigned short)(t)
+#if (IR_IDLE_TIME & 0xFF) == 0
+#define IRIdle(t)       (*((unsigned char*)&(t) + 1) >= (IR_IDLE_TIME >> 8))  // 16 ms, on the MSB alone
+#else
+#define IRIdle(t)       ((t) >= IRLong(IR_IDLE_TIME))
+#endif
+
+#if defined USAGE_COUNTERS
+#define CountUsage(i)   if(++UsageCount[i] == 0) UsageCount[i]--    // Count, but not beyond 255
+#else
+#define CountUsage(i)   (void)0
+#endif
+
 #define AddZeroToIRData()   IRData._dword >>= 1                                 // Add a 0 bit to IR data
 #define AddOneToIRData()    IRData._dword >>= 1; IRData._dword |= 0x80000000    // Add a 1 bit to IR data
 
@@ -102,20 +265,127 @@ typedef enum _NEC_STATES
     IR_REPEAT
 } NEC_STATES;
 
+// IR pulse classes, in the order of the time
+typedef enum _IR_PULSE
+{
+    PULSE_NOISE,
+    PULSE_560,
+    PULSE_890,
+    PULSE_1200,
+    PULSE_1690,
+    PULSE_2000,
+    PULSE_2250,
+    PULSE_4500,
+    PULSE_9000,
+    PULSE_11250,                        // Mark to mark, IR_CAPTURE_INT only
+    PULSE_13500,
+    PULSE_IDLE                          // More than 16 ms, a new frame
+} IR_PULSE;
+
+// RC5 states, at the start or the middle of a bit
+typedef enum _RC5_STATES
+{
+    RC5_IDLE,
+    RC5_START1,
+    RC5_MID1,
+    RC5_START0,
+    RC5_MID0
+} RC5_STATES;
+
+// SIRC states
+typedef enum _SIRC_STATES
+{
+    SIRC_IDLE,
+    SIRC_HEADER,
+    SIRC_SPACE,
+    SIRC_BIT
+} SIRC_STATES;
+
 // V A R I A B L E S
+#if defined LOAD_PROFILE
+#include "stable.h"                     // Generated by tools/stable.c
+#else
 //const unsigned char STable[10] = {0, 157, 165, 173, 181, 188, 195, 205, 216, 252};
 // Modified to latch low power (load) fans from low firing angle (on full speed)
-const unsigned char STable[10] = {0, 157, 165, 173, 181, 188, 195, 205, 216, 234};
+// Firing delays in us from the zero cross of 50 Hz mains, the TMR0 values above at 4 MHz
+#if MAINS_FREQ != 50
+#error "The hand tuned STable is for 50 Hz, use a LOAD_PROFILE from tools/stable -f"
+#endif
+#define PHASE_LONGEST   6336                            // Speed 1
+#define PHASE_SHORTEST  1408                            // Full speed
+const unsigned char STable[10] = {0,
+    PHASE_ANGLE(PHASE_LONGEST), PHASE_ANGLE(5824), PHASE_ANGLE(5312), PHASE_ANGLE(4800), PHASE_ANGLE(4352),
+    PHASE_ANGLE(3904), PHASE_ANGLE(3264), PHASE_ANGLE(2560), PHASE_ANGLE(PHASE_SHORTEST)};
+#endif
+// The delays fall with the speed, so the ends must be 1 to 255 TMR0 counts
+#if PHASE_STEPS(PHASE_LONGEST) > 255 || PHASE_STEPS(PHASE_SHORTEST) < 1
+#error "A firing delay does not fit TMR0 at this clock"
+#endif
+#if defined BURST_FIRE && !defined LOAD_PROFILE
+// The power of the speeds above on a resistive load at 50 Hz, as the part of the mains cycles
+// conducted in a burst; full speed is always on the phase angle
+const unsigned char BTable[10] = {0,
+    BURST_POWER(24), BURST_POWER(33), BURST_POWER(43), BURST_POWER(54), BURST_POWER(62),
+    BURST_POWER(71), BURST_POWER(81), BURST_POWER(90), 0};
+#endif
 near volatile BYTE Flag, Flag1, Status;
 near NEC_STATES IRState;
+#if !defined IR_NEC_ONLY
+near IR_PULSE IRPulse;
+#endif
+unsigned short IRBitTime;                               // The last IR edge interval, Timer 1 counts
 unsigned char IRDataCount, PhaseAngle, Speed, Time, Count;
 volatile near unsigned char EECounter, Ticks, Key, KeyCount;
-volatile unsigned int IRTime, TimeCounter;
+volatile unsigned short IRTime;                         // 16 bits, also on a host build (tools/sim)
+volatile unsigned int TimeCounter;
+#if T1_POSTSCALE > 1
+near unsigned char T1Count;
+#endif
+#if defined BURST_FIRE
+near unsigned char BurstDensity, BurstAcc;              // BTable entry (0 on the phase angle), the sigma-delta
+#endif
 DWORD IRData;
+#if defined USAGE_COUNTERS
+volatile near unsigned char UsageTicks;                 // Timer 1 ticks, folded into RunMinutes
+volatile unsigned char UsageCount[USAGE_COUNTS];        // Counts not yet in the eeprom
+unsigned int RunMinutes;                                // Run time at RunSpeed, not yet in the eeprom
+unsigned char RunSpeed, UsageIndex;
+unsigned char UsageStep;                                // Step of the counter flush next, from 1; 0 none going
+#endif
+#if defined IR_SAMSUNG || defined IR_RC5 || defined IR_SIRC
+unsigned char IRLastKey;
+#endif
+#if defined IR_SAMSUNG
+const unsigned char SamsungMap[] = {SAMSUNG_DIGIT0, DIGIT0, SAMSUNG_DIGIT1, DIGIT1, SAMSUNG_DIGIT2, DIGIT2, SAMSUNG_DIGIT3, DIGIT3,
+    SAMSUNG_DIGIT4, DIGIT4, SAMSUNG_DIGIT5, DIGIT5, SAMSUNG_DIGIT6, DIGIT6, SAMSUNG_DIGIT7, DIGIT7, SAMSUNG_DIGIT8, DIGIT8,
+    SAMSUNG_DIGIT9, DIGIT9, SAMSUNG_VOL_PLUS, VOL_PLUS, SAMSUNG_VOL_MINUS, VOL_MINUS, SAMSUNG_CH_PLUS, CH_PLUS,
+    SAMSUNG_CH_MINUS, CH_MINUS, NO_CMD};
+#endif
+#if defined IR_RC5
+const unsigned char RC5Map[] = {RC5_DIGIT0, DIGIT0, RC5_DIGIT1, DIGIT1, RC5_DIGIT2, DIGIT2, RC5_DIGIT3, DIGIT3,
+    RC5_DIGIT4, DIGIT4, RC5_DIGIT5, DIGIT5, RC5_DIGIT6, DIGIT6, RC5_DIGIT7, DIGIT7, RC5_DIGIT8, DIGIT8,
+    RC5_DIGIT9, DIGIT9, RC5_VOL_PLUS, VOL_PLUS, RC5_VOL_MINUS, VOL_MINUS, RC5_CH_PLUS, CH_PLUS,
+    RC5_CH_MINUS, CH_MINUS, NO_CMD};
+#endif
+#if defined IR_SIRC
+const unsigned char SIRCMap[] = {SIRC_DIGIT0, DIGIT0, SIRC_DIGIT1, DIGIT1, SIRC_DIGIT2, DIGIT2, SIRC_DIGIT3, DIGIT3,
+    SIRC_DIGIT4, DIGIT4, SIRC_DIGIT5, DIGIT5, SIRC_DIGIT6, DIGIT6, SIRC_DIGIT7, DIGIT7, SIRC_DIGIT8, DIGIT8,
+    SIRC_DIGIT9, DIGIT9, SIRC_VOL_PLUS, VOL_PLUS, SIRC_VOL_MINUS, VOL_MINUS, SIRC_CH_PLUS, CH_PLUS,
+    SIRC_CH_MINUS, CH_MINUS, NO_CMD};
+#endif
+
+#if !defined SIM
+#define SimLoop()                       // Main loop hook of the host simulator (tools/sim)
+#endif
 
 // F U N C T I O N   P R O T O T Y P E S
 void IRHandler(void);
+void IRDecoder(void);
 void NECDecoder(void);
+void RC5Decoder(void);
+void SIRCDecoder(void);
+void IRFrame(unsigned char Cmd, unsigned char Key);
+unsigned char TranslateCmd(const unsigned char *Map, unsigned char Cmd);
 void InitIR(void);
 void SetSpeed(void);
 void OffTimer(void);
@@ -126,21 +396,31 @@ void SetEEVariables(void);
 void KeyDelay(void);
 void interrupt isr(void);
 void Delay2s(void);
+void FlushUsage(void);
+void EEAdd(unsigned char Address, unsigned char Size, unsigned int Value);
+void ShowUsage(void);
+void BlinkDigit(unsigned char Digit);
+void BlinkDelay(unsigned char Tens);
 
 // M A I N
 void main(void)
 {
+#if _XTAL_FREQ == 4000000
     OSCCAL = _READ_OSCCAL_DATA();                       // Set oscillator calibration
+#endif
     GPIO    = 0;                                        // Clear PORT
     TriacOff();                                         // Triac off
-    TRISIO  = ZC_PIN_MASK | IR_PIN_MASK | 0x05;         // IR, Zero cross and swiches
-    WPU     = 0x05;                                     // Weak pull up enabled for wwitches
-    IOC     = ZC_PIN_MASK | IR_PIN_MASK;                // Interrupt on change is enabled for GPIO2, GPIO4
+#if defined _16F676
+    TRISC   = 0x00;                                     // PORTC outputs, after the TRIAC is off
+#endif
+    TRISIO  = ZC_PIN_MASK | IR_PIN_MASK | SW_UP_MASK | SW_DN_MASK;  // IR, Zero cross and swiches
+    WPU     = SW_UP_MASK | SW_DN_MASK;                  // Weak pull up enabled for wwitches
+    IOC     = IOC_MASK;                                 // Interrupt on change for zero cross (and IR)
     ANSEL   = 0x00;                                     // All are digital i/o
     CMCON   = 0x07;                                     // Comparators off
-    INTCON  = 0x68;                                     // Enable PEIE, Timer0, Port change interrupts
-    OPTION  = 0x05;                                     // INT falling edge, Prescaler 1:64
-    T1CON   = 0x31;                                     // Prescaler 1:8, internal clk, TMR1ON
+    INTCON  = INTCON_INIT;                              // Enable PEIE, Timer0, Port change (INT) interrupts
+    OPTION  = OPTION_INIT;                              // INT falling edge, Prescaler 1:64 at 4 MHz
+    T1CON   = T1CON_INIT;                               // Prescaler 1:8, internal clk, TMR1ON
     LEDOn();
     Flag._byte = 0;                                     // Initialise flags and variables
     Flag1._byte = 0;
@@ -156,16 +436,23 @@ void main(void)
 #endif
     GIE = 1;                                            // Enable interrupts
     SetSpeed();                                         // Set the speed
+#if defined USAGE_COUNTERS
+    RunSpeed = Speed;
+#endif
     LEDOff();                                           // Turn off LED
     Count = Time << 1;                                  // Count = Time * 2, i.e turn on/off
     Ticks = 0;
     do
     {
-        NECDecoder();                                   // Decode NEC formatted IR data
+        SimLoop();
+        IRDecoder();                                    // Decode IR data
         if(IRNewHit)                                    // Is any new data?
         {
             IRNewHit = 0;                               // Y. Clear flag
+            CountUsage(USAGE_IR_FRAMES);
             IRHandler();                                // Do the command
+            if(UnknownCmd)
+                CountUsage(USAGE_UNKNOWN);
         }
         if(IRCmdRepeat)                                 // As long as the repeat command present
         {                                               // do not turn of LED
@@ -177,6 +464,20 @@ void main(void)
             EEPromWrite = 0;                            // Clear eeprom update flag
             SetEEVariables();                           // Write variables if necessory
         }
+#if defined USAGE_COUNTERS
+        if(UsageStep != 0 && !WR)                       // A step of the counter flush a pass, once the last
+            FlushUsage();                               // write is over: IRDecoder() keeps up meanwhile
+        if(UsageTicks >= USAGE_MINUTE)                  // A minute more, for RunSpeed only (till the next flush)
+        {
+            UsageTicks -= USAGE_MINUTE;
+            if(FanOn && (Speed == RunSpeed) && (++RunMinutes == 0))
+                RunMinutes--;
+            if(RunMinutes >= USAGE_FLUSH || (RunMinutes != 0 && UsageCount[USAGE_STARTS] != 0))
+            {                                           // Saved on their own every USAGE_FLUSH minutes of running,
+                UsageStep = 1;                          // and a minute into a run the settings did not save (power
+            }                                           // on), the wall switch loses no more (usage.h)
+        }
+#endif
         if(ClearLED)
         {
             if(Ticks & 0x20)                            // If remote command received, turn off LED after only
@@ -233,13 +534,13 @@ The function is used to decode IR commands and make changes required
 */
 void IRHandler(void)
 {
-    if(!(IRData.byte0 ^ IRData.byte1) == 0)             // Address and its compliment match
+    UnknownCmd = 0;                                     // Set for a valid frame with an unused command only
+    if((IRData.byte0 ^ IRData.byte1) != 0)              // Address and its compliment match
      {
          if(IRData.byte0 == 0)                          // Address  is zero
          {
-             if(!(IRData.byte2 ^ IRData.byte3) == 0)    // Command and its compliment match
+             if((IRData.byte2 ^ IRData.byte3) != 0)     // Command and its compliment match
              {
-                UnknownCmd = 0;
                 switch(IRData.byte2)
                 {
                     case VOL_PLUS:
@@ -315,6 +616,12 @@ void IRHandler(void)
                     OffTimer();
                     break;
 
+#if defined USAGE_COUNTERS
+                    case CH:                // Service, blink the next usage counter
+                    ShowUsage();
+                    break;
+#endif
+
                     case PLAY:
                     OnTimer();
                     break;
@@ -405,6 +712,10 @@ void SetSpeed(void)
     if(StartFan){                                       // If required, try to start the fan
         if(!FanOn){                                     // Already running?
             FanOn = 1;                                  // No. Switch on fan
+            CountUsage(USAGE_STARTS);
+#if defined BURST_FIRE
+            BurstDensity = 0;                           // The start is on the phase angle
+#endif
             PhaseAngle = STable[9];                     // If just swiched on run it on full speed
             Delay2s();                                  // for a short time
         }
@@ -412,14 +723,18 @@ void SetSpeed(void)
     }
     if(FanOn == 0) OffTimer();
     PhaseAngle = STable[Speed];                         // Set the phase angle for the speed
+#if defined BURST_FIRE
+    BurstDensity = (Speed <= BURST_FIRE) ? BTable[Speed] : 0; // Or the burst density, in one write for isr()
+#endif
     EECounter = 0;                                      // Update EEPROM
 }
 /**
-Decode the IR data received in NEC format
+Time the IR line change and classify it, then run the decoders of all the enabled protocols
+with the same pulse class. NEC alone is decoded on the time, without the classes
 */
-void NECDecoder(void)
+void IRDecoder(void)
 {
-    static unsigned int IRBitTime, PrevIRTimer;
+    static unsigned short PrevIRTimer;
     #if 0
     static unsigned char Port;
     if((Port ^ GPIO) & IR_PIN_MASK)                     // IR line changed
@@ -429,99 +744,489 @@ void NECDecoder(void)
         Port = GPIO;
         IRBitTime = IRTime - PrevIRTimer;
         PrevIRTimer = IRTime;
-        if(IRBitTime & 0x0800)
-            IRState = IR_IDLE;               // Idle for more than 16 ms
         IRRx = 0;
     #else
     if(IRRx)
     {
         IRBitTime = IRTime - PrevIRTimer;
         PrevIRTimer = IRTime;
-        if(IRBitTime & 0x0800)
-            IRState = IR_IDLE;              // Idle for more than 16 ms
         IRRx = 0;
     #endif
-        Error = 0;
-        switch(IRState)
-        {
-            case IR_IDLE:
-            if(IsIRDataBitHigh())           // If it is a one, IR starting
-                IRState++;                  // Now is IR_MARK
-            IRDataCount = 0;
-            IRData._dword = 0;
-            break;
+#if defined IR_NEC_ONLY
+        NECDecoder();
+#else
+#if PULSE_2000_MAX < 0x100
+        if(IRBitTime < 0x100)                           // High byte clear, the short classes on the LSB
+#else
+        if(IRBitTime <= IRShort(PULSE_2000_MAX))
+#endif
+        {                                               // Up from the shortest, a NEC bit mark is 2 compares
+            if(IRShort(IRBitTime) < IRShort(MIN_IR_BIT_TIME))
+                IRPulse = PULSE_NOISE;
+            else if(IRShort(IRBitTime) <= IRShort(PULSE_560_MAX))
+                IRPulse = PULSE_560;
+            else if(IRShort(IRBitTime) <= IRShort(PULSE_890_MAX))
+                IRPulse = PULSE_890;
+            else if(IRShort(IRBitTime) <= IRShort(PULSE_1200_MAX))
+                IRPulse = PULSE_1200;
+            else if(IRShort(IRBitTime) <= IRShort(PULSE_1690_MAX))
+                IRPulse = PULSE_1690;
+            else if(IRShort(IRBitTime) <= IRShort(PULSE_2000_MAX))
+                IRPulse = PULSE_2000;
+            else
+                IRPulse = PULSE_2250;                   // The byte path only, from PULSE_2000_MAX to 255
+        }
+        else if(IRIdle(IRBitTime))
+            IRPulse = PULSE_IDLE;                       // Idle for more than 16 ms
+#if defined IR_CAPTURE_INT
+        else if(IRBitTime > IRLong(PULSE_11250_MAX))
+            IRPulse = PULSE_13500;
+        else if(IRBitTime > IRLong(PULSE_9000_MAX))
+            IRPulse = PULSE_11250;
+#endif
+        else if(IRBitTime > IRLong(PULSE_4500_MAX))
+            IRPulse = PULSE_9000;
+        else if(IRBitTime > IRLong(PULSE_2250_MAX))
+            IRPulse = PULSE_4500;
+        else
+            IRPulse = PULSE_2250;
+#if defined IR_NEC || defined IR_SAMSUNG
+        NECDecoder();
+#endif
+#if defined IR_RC5
+        RC5Decoder();
+#endif
+#if defined IR_SIRC
+        SIRCDecoder();
+#endif
+#endif
+        IR05Seconds = 0;
+    }// if(IRRx)
+}
+#if defined IR_CAPTURE_INT
+/**
+Decode the NEC data from the time between the starts of the marks, the only edges timed with
+the INT capture. The header and its space is a 13.5 ms period, a repeat 11.25 ms, and a bit is
+1.12 ms (zero) or 2.25 ms (one); the stop bit mark closes the last bit. Each state compares the
+time with the limits of the pulse classes it accepts
+*/
+void NECDecoder(void)
+{
+    Error = 0;
+    if(IRIdle(IRBitTime))
+        IRState = IR_IDLE;                  // Idle for more than 16 ms
+    switch(IRState)
+    {
+        case IR_IDLE:                       // Start of the header mark
+        IRState = IR_MARK;
+        IRDataCount = 0;
+        IRData._dword = 0;
+        break;
 
-            case IR_MARK:                   // Now IR Mark just over
-            if(IRBitTime < IR_MARK_MIN_TIME)
+        case IR_MARK:                       // Header mark and space just over
+        if(IRBitTime <= IRLong(PULSE_11250_MAX))
+        {
+            if(IRBitTime > IRLong(PULSE_9000_MAX))
             {
-                Error = 1;                  // Less than specified mark time
+                IRCmdRepeat = 1;            // A repeat command
+                IRState = IR_IDLE;
+                break;
             }
-            IRState++;
-            break;
+            Error = 1;                      // Shorter than a repeat
+        }
+        IRState = IR_LOW;
+        break;
 
-            case IR_SPACE:                  // Now IR space just over
-            if(IRBitTime < IR_SPACE_MIN_TIME)
-            {
+        case IR_LOW:                        // A bit just over
+        if(IRBitTime > IRLong(PULSE_2000_MAX))
+        {
+            if(IRBitTime > IRLong(PULSE_2250_MAX))
+                Error = 1;                  // Too long
+            AddOneToIRData();               // Longer period, add a one
+        }
+        else
+        {                                   // Up to PULSE_2000_MAX, the LSB when that fits a byte
+            if(IRShort(IRBitTime) <= IRShort(PULSE_890_MAX) || IRShort(IRBitTime) > IRShort(PULSE_1200_MAX))
+                Error = 1;                  // Too short, or between a zero and a one
+            AddZeroToIRData();              // Short period, add a zero
+        }
+        IRDataCount++;
+        break;
+
+        default:
+        Error = 1;
+        break;
+    }// switch(IRState)
+    if(Error)
+    {
+        CountUsage(USAGE_IR_REJECTS);
+        InitIR();
+    }
+    if(IRDataCount == 32)
+    {
+        IRNewHit = 1;
+        IRState = IR_IDLE;
+        IRDataCount = 0;
+    }
+}
+#elif defined IR_NEC_ONLY
+/**
+Decode the IR data received in NEC format, on the time itself as 0.7 did: each state compares
+only the limits of the times it accepts, the same limits as the pulse classes. With the short
+classes in a byte the bit states compare the LSB, a time with the high byte set is handled first
+*/
+void NECDecoder(void)
+{
+    Error = 0;
+#if PULSE_2000_MAX < 0x100
+    if(IRBitTime >= 0x100)                  // High byte set
+#endif
+    {
+        if(IRIdle(IRBitTime))
+            IRState = IR_IDLE;              // Idle for more than 16 ms
+#if PULSE_2000_MAX < 0x100
+        else if(IRState >= IR_HIGH)
+            Error = 1;                      // Too long for a bit, the states below see only the LSB
+#endif
+    }
+    switch(IRState)
+    {
+        case IR_IDLE:
+        if(IsIRDataBitHigh())               // If it is a one, IR starting
+            IRState++;                      // Now is IR_MARK
+        IRDataCount = 0;
+        IRData._dword = 0;
+        break;
+
+        case IR_MARK:                       // Now IR Mark just over
+        if(IRBitTime <= IRLong(PULSE_4500_MAX))
+        {
+            Error = 1;                      // Less than specified mark time
+        }
+        IRState++;
+        break;
+
+        case IR_SPACE:                      // Now IR space just over
+        if(IRBitTime <= IRLong(PULSE_2250_MAX))
+        {
+            if(IRBitTime <= IRLong(PULSE_1690_MAX))
                 Error = 1;                  // Less than specified space time
-            }
-            if(IRBitTime < IR_SPACE_MIN_TIME * 2)
-            {
-                IRState = IR_REPEAT;        // If it is less than 4.5 ms, it may be a repeat command
-                break;
-            }
-            IRState++;                      // Space is 4.5 ms, now IR high
+            IRState = IR_REPEAT;            // If it is less than 4.5 ms, it may be a repeat command
             break;
+        }
+        IRState++;                          // Space is 4.5 ms, now IR high
+        break;
 
-            case IR_HIGH:                   // IR high just over, check it
-            if(((unsigned char) IRBitTime < MIN_IR_BIT_TIME) || ((unsigned char) IRBitTime > MAX_IR_BIT_TIME))
-            {
-                Error = 1;                  // Too short or too long pulse
-            }
-            IRState++;
-            break;
+        case IR_HIGH:                       // IR high just over, check it
+        if(IRShort(IRBitTime) < IRShort(MIN_IR_BIT_TIME) || IRShort(IRBitTime) > IRShort(PULSE_560_MAX))
+        {
+            Error = 1;                      // Too short or too long pulse
+        }
+        IRState++;
+        break;
 
-            case IR_LOW:                    // IR low just over, check it
-            if(((unsigned char) IRBitTime < MIN_IR_BIT_TIME) || ((unsigned char) IRBitTime > MAX_IR_BIT_TIME * 3))
-            {
-                Error = 1;                  // Too short or too long pulse
-            }
-            if((unsigned char) IRBitTime >= MIN_IR_BIT_TIME * 3)
-            {
-                AddOneToIRData();           // Longer low time, add a one
-            }
-            else
-            {
-                AddZeroToIRData();          // Short low time add a zero
-            }
-            IRDataCount++;                  // Increment the counter
-            IRState--;                      // Now is IR High
-            break;
+        case IR_LOW:                        // IR low just over, check it
+        if(IRShort(IRBitTime) > IRShort(PULSE_1200_MAX))
+        {
+            if(IRShort(IRBitTime) > IRShort(PULSE_2000_MAX))
+                Error = 1;                  // Too long pulse
+            AddOneToIRData();               // Longer low time, add a one
+        }
+        else
+        {
+            if(IRShort(IRBitTime) < IRShort(MIN_IR_BIT_TIME))
+                Error = 1;                  // Too short pulse
+            AddZeroToIRData();              // Short low time add a zero
+        }
+        IRDataCount++;                      // Increment the counter
+        IRState--;                          // Now is IR High
+        break;
 
-            case IR_REPEAT:                 // In repeat, the 560us IR burst just over, check it now
-            if(((unsigned char) IRBitTime < MIN_IR_BIT_TIME) || ((unsigned char) IRBitTime > MAX_IR_BIT_TIME))
-            {
-                IRCmdRepeat = 0;
-                Error = 1;
-            }
-            IRCmdRepeat = 1;
-            IRState = IR_IDLE;
+        case IR_REPEAT:                     // In repeat, the 560us IR burst just over, check it now
+        if(IRShort(IRBitTime) < IRShort(MIN_IR_BIT_TIME) || IRShort(IRBitTime) > IRShort(PULSE_560_MAX))
+        {
+            IRCmdRepeat = 0;
+            Error = 1;
+        }
+        IRCmdRepeat = 1;
+        IRState = IR_IDLE;
+        break;
+
+    }// switch(IRState)
+    if(Error)
+    {
+        CountUsage(USAGE_IR_REJECTS);
+        InitIR();
+    }
+    if(IRDataCount == 32)
+    {
+        IRNewHit = 1;
+        IRState = IR_IDLE;
+        IRDataCount = 0;
+    }
+}
+#elif defined IR_NEC || defined IR_SAMSUNG
+/**
+Decode the IR data received in NEC format. A Samsung frame differs only in the header mark
+(4.5 ms) and the address, so it is decoded here as well
+*/
+void NECDecoder(void)
+{
+    Error = 0;
+    if(IRPulse == PULSE_IDLE)
+        IRState = IR_IDLE;
+    switch(IRState)
+    {
+        case IR_IDLE:
+        if(IsIRDataBitHigh())               // If it is a one, IR starting
+            IRState++;                      // Now is IR_MARK
+        IRDataCount = 0;
+        IRData._dword = 0;
+        break;
+
+        case IR_MARK:                       // Now IR Mark just over
+        IRSamsung = 0;
+#if defined IR_SAMSUNG
+        if(IRPulse == PULSE_4500)
+            IRSamsung = 1;                  // Samsung header mark
+        else
+#endif
+#if defined IR_NEC
+        if(IRPulse != PULSE_9000)
+#endif
+        {
+            Error = 1;                      // Less than specified mark time
+        }
+        IRState++;
+        break;
+
+        case IR_SPACE:                      // Now IR space just over
+        if(IRPulse < PULSE_2000)
+        {
+            Error = 1;                      // Less than specified space time
+        }
+        if(IRPulse <= PULSE_2250)
+        {
+            IRState = IR_REPEAT;            // If it is less than 4.5 ms, it may be a repeat command
             break;
+        }
+        IRState++;                          // Space is 4.5 ms, now IR high
+        break;
 
-        }// switch(IRState)
-        if(Error)
+        case IR_HIGH:                       // IR high just over, check it
+        if(IRPulse != PULSE_560)
         {
-            InitIR();
+            Error = 1;                      // Too short or too long pulse
         }
-        if(IRDataCount == 32)
+        IRState++;
+        break;
+
+        case IR_LOW:                        // IR low just over, check it
+        if(IRPulse >= PULSE_1690)
         {
-            IRNewHit = 1;
-            IRState = IR_IDLE;
-            IRDataCount = 0;
-            //IROff = 0;
+            if(IRPulse > PULSE_2000)
+                Error = 1;                  // Too long pulse
+            AddOneToIRData();               // Longer low time, add a one
         }
-        IR05Seconds = 0;
-    }// if(IRRx)
+        else
+        {
+            if(IRPulse == PULSE_NOISE)
+                Error = 1;                  // Too short pulse
+            AddZeroToIRData();              // Short low time add a zero
+        }
+        IRDataCount++;                      // Increment the counter
+        IRState--;                          // Now is IR High
+        break;
+
+        case IR_REPEAT:                     // In repeat, the 560us IR burst just over, check it now
+        if(IRPulse != PULSE_560)
+        {
+            IRCmdRepeat = 0;
+            Error = 1;
+        }
+        IRCmdRepeat = 1;
+        IRState = IR_IDLE;
+        break;
+
+    }// switch(IRState)
+    if(Error)
+    {
+        CountUsage(USAGE_IR_REJECTS);
+        InitIR();
+    }
+    if(IRDataCount == 32)
+    {
+#if defined IR_SAMSUNG
+        if(IRSamsung)                       // Address is sent twice, the command with its compliment
+        {
+            if((IRData.byte0 == SAMSUNG_ADDRESS) && (IRData.byte1 == SAMSUNG_ADDRESS) && ((IRData.byte2 ^ IRData.byte3) == 0xFF))
+                IRFrame(TranslateCmd(SamsungMap, IRData.byte2), IRData.byte2);
+        }
+        else
+#endif
+        IRNewHit = 1;
+        IRState = IR_IDLE;
+        IRDataCount = 0;
+        //IROff = 0;
+    }
+}
+#endif
+#if defined IR_RC5
+/**
+Decode Philips RC5, 14 bits Manchester coded, with a 889us half bit. A bit is taken at its
+middle transition, a one is a space to mark change. Start is on the first mark, the middle
+of the first start bit
+*/
+void RC5Decoder(void)
+{
+    static RC5_STATES RC5State;
+    static unsigned char RC5Count;
+    static WORD RC5Data;
+    unsigned char Bit;
+
+    if(IRPulse == PULSE_IDLE)
+        RC5State = RC5_IDLE;
+    Bit = 2;                                // No new bit
+    switch(RC5State)
+    {
+        case RC5_IDLE:
+        if(IsIRDataBitHigh())               // First mark, middle of the start bit
+        {
+            RC5Data._word = 0;
+            RC5Count = 0;
+            Bit = 1;
+        }
+        break;
+
+        case RC5_MID1:                      // A mark just over
+        if(IRPulse == PULSE_890)
+            RC5State = RC5_START1;          // Space follows, next is a one
+        else if((IRPulse == PULSE_1690) || (IRPulse == PULSE_2000))
+            Bit = 0;                        // Mark runs into the next bit, a zero
+        else
+            RC5State = RC5_IDLE;
+        break;
+
+        case RC5_MID0:                      // A space just over
+        if(IRPulse == PULSE_890)
+            RC5State = RC5_START0;          // Mark follows, next is a zero
+        else if((IRPulse == PULSE_1690) || (IRPulse == PULSE_2000))
+            Bit = 1;                        // Space runs into the next bit, a one
+        else
+            RC5State = RC5_IDLE;
+        break;
+
+        case RC5_START1:                    // Half of a one
+        case RC5_START0:                    // Half of a zero
+        if(IRPulse == PULSE_890)
+            Bit = (RC5State == RC5_START1);
+        else
+            RC5State = RC5_IDLE;
+        break;
+    }
+    if(Bit < 2)
+    {
+        RC5State = Bit ? RC5_MID1 : RC5_MID0;
+        RC5Data._word <<= 1;
+        RC5Data._word |= Bit;
+        if(++RC5Count == 14)                // S1, S2, toggle, 5 address and 6 command bits
+        {
+            RC5State = RC5_IDLE;
+            if((RC5Data._word & 0x1000) && (((RC5Data._word >> 6) & 0x1F) == RC5_ADDRESS))
+                IRFrame(TranslateCmd(RC5Map, LSB(RC5Data) & 0x3F), (LSB(RC5Data) & 0x3F) | ((MSB(RC5Data) & 0x08) << 3));
+        }
+    }
 }
+#endif
+#if defined IR_SIRC
+/**
+Decode Sony SIRC 12 bit frames. A 2.4 ms header mark, then the bits LSB first, each a 600us
+space and a 1200us (one) or 600us (zero) mark; 7 command and 5 address bits
+*/
+void SIRCDecoder(void)
+{
+    static SIRC_STATES SIRCState;
+    static unsigned char SIRCCount;
+    static WORD SIRCData;
+
+    if(IRPulse == PULSE_IDLE)
+        SIRCState = SIRC_IDLE;
+    switch(SIRCState)
+    {
+        case SIRC_IDLE:
+        if(IsIRDataBitHigh())               // Header mark started
+            SIRCState++;
+        break;
+
+        case SIRC_HEADER:                   // Header mark just over
+        SIRCState = SIRC_IDLE;
+        if(IRPulse == PULSE_2250)
+        {
+            SIRCState = SIRC_SPACE;
+            SIRCCount = 0;
+        }
+        break;
+
+        case SIRC_SPACE:                    // Space before a bit just over
+        SIRCState = (IRPulse == PULSE_560) ? SIRC_BIT : SIRC_IDLE;
+        break;
+
+        case SIRC_BIT:                      // Bit mark just over, LSB first to the MSB
+        SIRCState = SIRC_SPACE;
+        SIRCData._word >>= 1;
+        if(IRPulse == PULSE_1200)
+            SIRCData._word |= 0x8000;
+        else if(IRPulse != PULSE_560)
+            SIRCState = SIRC_IDLE;
+        if(++SIRCCount == 12)
+        {
+            SIRCData._word >>= 4;           // Bits to the right place
+            if((SIRCState == SIRC_SPACE) && ((SIRCData._word >> 7) == SIRC_ADDRESS))
+                IRFrame(TranslateCmd(SIRCMap, LSB(SIRCData) & 0x7F), LSB(SIRCData) & 0x7F);
+            SIRCState = SIRC_IDLE;
+        }
+        break;
+    }
+}
+#endif
+#if defined IR_SAMSUNG || defined IR_RC5 || defined IR_SIRC
+/**
+Translate a command of another protocol to the NEC one, the map is a list of pairs
+ending with NO_CMD
+*/
+unsigned char TranslateCmd(const unsigned char *Map, unsigned char Cmd)
+{
+    while(*Map != NO_CMD)
+    {
+        if(*Map == Cmd)
+            return Map[1];
+        Map += 2;
+    }
+    return NO_CMD;                                      // Not used, IRHandler() takes it as unknown
+}
+/**
+Hand over a RC5, SIRC or Samsung frame to IRHandler(), in the NEC layout. These remotes send
+the whole frame again while the key is held, so the same key within the repeat time is only
+a repeat. RC5 sends a toggle bit with the key, so a fresh press is always seen
+*/
+void IRFrame(unsigned char Cmd, unsigned char Key)
+{
+    if(IRBurst && (Key == IRLastKey))
+    {
+        IRCmdRepeat = 1;
+    }
+    else
+    {
+        IRData.byte0 = 0;                               // Address and its compliment
+        IRData.byte1 = 0xFF;
+        IRData.byte2 = Cmd;                             // Command and its compliment
+        IRData.byte3 = ~Cmd;
+        IRNewHit = 1;
+    }
+    IRLastKey = Key;
+    IRBurst = 1;
+}
+#endif
 /**
 Initialise IR states
 */
@@ -547,18 +1252,164 @@ Write to eeprom, the variables
 void SetEEVariables(void)
 {
     // Compare with the eeprom variables and update if necessory
+    EEWritten = 0;
     if(Speed != eeprom_read(0))
+    {
         eeprom_write(0, Speed);
+        EEWritten = 1;
+    }
     if(EETimeUpdate)                                    // Time may change while running, so only update
     {                                                   // if user make changes
         if(Time != eeprom_read(1))
+        {
             eeprom_write(1, Time);
+            EEWritten = 1;
+        }
         EETimeUpdate = 0;
     }
     if(Status._byte != eeprom_read(2))
+    {
         eeprom_write(2, Status._byte);
+        EEWritten = 1;
+    }
+#if defined USAGE_COUNTERS
+    if(EEWritten)                                       // Along with the settings
+    {
+        UsageSaved = 1;
+        UsageStep = 1;
+    }
+#endif
+}
+#if defined USAGE_COUNTERS
+/**
+Add the RAM counts to the eeprom counters, and clear them, a counter on each call from
+UsageStep 1 until it is 0 again. The run time goes to the speed it was counted for, then the
+counts, then EE_WRITES when UsageSaved. Each cell is written once at most (wear in usage.h).
+The main loop takes a step a pass, so a flush (up to 8 writes of 5 ms) does not hold the IR
+decoding for a frame
+*/
+void FlushUsage(void)
+{
+    unsigned char i = UsageStep - 2, Count;
+
+    if(UsageStep == 1)
+    {
+        if(RunSpeed != 0)
+            EEAdd(EE_RUN_MINUTES - 3 + RunSpeed * 3, 3, RunMinutes);
+        RunMinutes = 0;
+        RunSpeed = Speed;
+    }
+    else if(i < USAGE_COUNTS)
+    {
+        Count = UsageCount[i];
+        UsageCount[i] -= Count;                         // The ISR may count meanwhile
+        EEAdd(EE_COUNTS + (i << 1), 2, Count);
+    }
+    else
+    {
+        if(UsageSaved)
+            EEAdd(EE_WRITES, 2, 1);
+        UsageSaved = 0;
+        UsageStep = 0;
+        return;
+    }
+    UsageStep++;
 }
 /**
+Add a value to a little endian eeprom counter of Size bytes, writing only the bytes that change
+*/
+void EEAdd(unsigned char Address, unsigned char Size, unsigned int Value)
+{
+    unsigned char Byte, Sum;
+
+    while(Value != 0 && Size-- != 0)
+    {
+        Byte = eeprom_read(Address);
+        Sum = Byte + (unsigned char)Value;
+        Value >>= 8;
+        if(Sum < Byte)                                  // Carry to the next byte
+            Value++;
+        if(Sum != Byte)
+            eeprom_write(Address, Sum);
+        Address++;
+    }
+}
+/**
+Blink the next usage counter on the LED, on each press of the service key. The counter number
+(1-15, see usage.h) first, then after a pause its value in hex, most significant digit first
+without the leading zeros. A digit is as many short blinks, a zero one long blink
+*/
+void ShowUsage(void)
+{
+    unsigned char Address, Size, Byte, Shown;
+
+    UsageStep = 1;                                      // Show the counts of this run as well
+    while(UsageStep != 0)
+        FlushUsage();
+    if(++UsageIndex > USAGE_SHOWN)
+        UsageIndex = 1;
+    LEDOff();
+    BlinkDelay(100);
+    BlinkDigit(UsageIndex);
+    BlinkDelay(100);
+    if(UsageIndex <= 9)
+    {
+        Address = EE_RUN_MINUTES + UsageIndex * 3;      // Run times, from the MSB
+        Size = 3;
+    }
+    else
+    {
+        Address = EE_COUNTS - 18 + (UsageIndex << 1);   // Counts and the writes
+        Size = 2;
+    }
+    Shown = 0;
+    do
+    {
+        Byte = eeprom_read(--Address);
+        if(Shown || (Byte & 0xF0))
+        {
+            BlinkDigit(Byte >> 4);
+            Shown = 1;
+        }
+        if(Shown || (Byte & 0x0F) || (Size == 1))
+        {
+            BlinkDigit(Byte & 0x0F);
+            Shown = 1;
+        }
+    }while(--Size != 0);
+}
+/**
+Blink a digit, 0.4 s for each count or a 1 s blink for a zero, then a 1 s pause
+*/
+void BlinkDigit(unsigned char Digit)
+{
+    if(Digit == 0)
+    {
+        LEDOn();
+        BlinkDelay(100);
+    }
+    while(Digit-- != 0)
+    {
+        LEDOn();
+        BlinkDelay(15);
+        LEDOff();
+        BlinkDelay(25);
+    }
+    LEDOff();
+    BlinkDelay(100);
+}
+/**
+Delay in 10 ms steps
+*/
+void BlinkDelay(unsigned char Tens)
+{
+    do
+    {
+        __delay_ms(10);
+    }while(--Tens != 0);
+}
+#endif
+/**
 Create a 2 seconds delay, used to start the fan
 */
 void Delay2s(void)
@@ -569,7 +1420,8 @@ void Delay2s(void)
         __delay_ms(10);
 }
 /**
-Delay after a key press. This function retuns after a specified time or when no key pressed down
+Delay after a key press, 500 ms. It was meant to return on the release, but the test (!Key & 0x80)
+was never true; the fans in use pace the steps this way, so the full delay is kept
 */
 void KeyDelay(void)
 {
@@ -577,8 +1429,6 @@ void KeyDelay(void)
     ms = 250;                                           // 500 ms delay
     do
     {
-        if(!ANY_KEY)                                    // If key released, return
-            break;
         __delay_ms(2);
     }while(--ms != 0);
 }
@@ -594,11 +1444,36 @@ void interrupt isr(void)
         PortChanges ^= PortStatus;                      // Find the differences
         if(PortChanges & ZC_PIN_MASK)                   // Zero cross
         {
+#if defined BURST_FIRE
+            if(BurstDensity)                            // Burst fired, whole mains cycles; TMR0 is loaded below
+            {                                           // but does not interrupt, and a burst speed is never full
+                T0IE = 0;
+                if(PortStatus & ZC_PIN_MASK)            // A new mains cycle, the next step of the pattern
+                {
+                    BurstOn = 0;
+                    BurstAcc += BurstDensity;           // The carry conducts the cycle
+                    if(FanOn && (BurstAcc < BurstDensity))
+                        BurstOn = 1;
+                }
+                if(FanOn && BurstOn)                    // Hold the gate through both half cycles, unless the
+                    TriacOn();                          // timer or a key turned the fan off meanwhile
+                else
+                    TriacOff();
+            }
+            else if(!T0IE)                              // Back on the phase angle from a burst
+            {
+                TriacOff();
+                BurstOn = 0;
+                T0IF = 0;
+                T0IE = 1;
+            }
+#endif
             TMR0 = PhaseAngle;                          // Phase angle is controlled via TMR0, on interrupt it trigger
             if(FanOn && (PhaseAngle >= STable[9])){     // For full speed hold trigger from now, and TMR0 interrupt (delayed
                 TriacOn();                              // to reach TRIAC holding current) clear the trigger
             }
             Ticks++;                                    // Ticks @ 10 ms
+#if defined HI_TECH_C
             {
             #asm
             INCFSZ      _KeyCount,W                     // Inc Key Count, but not beyond 255
@@ -613,51 +1488,99 @@ void interrupt isr(void)
             CLRF        _KeyCount                       // N. Clear the counter
             #endasm
             }
+#else
+            if(KeyCount != 255)                         // Same as above, for a host build
+                KeyCount++;
+            Key = 0;
+            if(!(PortStatus & SW_UP_MASK))
+                Key = 0x81;
+            if(!(PortStatus & SW_DN_MASK))
+                Key = 0x82;
+            if(!(Key & 0x80))
+                KeyCount = 0;
+#endif
         }//if(PortChanges & ZC_PIN_MASK)
+#if !defined IR_CAPTURE_INT
         if(PortChanges & IR_PIN_MASK)                   // IR line changed
         {
-            *((unsigned char*)&IRTime) = TMR1L;         // Copy the current Timer 1 value (LSB)
-            *((unsigned char*)&IRTime + 1) = TMR1H;     // -- do -- (MSB)
+            *((unsigned char*)&IRTime + 1) = TMR1H;     // Copy the current Timer 1 value (MSB)
+            *((unsigned char*)&IRTime) = TMR1L;         // -- do -- (LSB)
+            if(*((unsigned char*)&IRTime) == 0)         // TMR1L rolled over, maybe after the MSB read
+                *((unsigned char*)&IRTime + 1) = TMR1H;
             IRRx = 1;
         }
+#endif
+    }
+#if defined IR_CAPTURE_INT
+    if(INTF)                                            // Start of an IR mark
+    {
+        *((unsigned char*)&IRTime + 1) = TMR1H;         // Copy the current Timer 1 value (MSB)
+        *((unsigned char*)&IRTime) = TMR1L;             // -- do -- (LSB)
+        if(*((unsigned char*)&IRTime) == 0)             // TMR1L rolled over, maybe after the MSB read
+            *((unsigned char*)&IRTime + 1) = TMR1H;
+        INTF = 0;
+        IRRx = 1;
     }
+#endif
+#if defined BURST_FIRE
+    if(T0IF && T0IE)                                    // Not while burst fired, the gate is held then
+#else
     if(T0IF)                                            // Interrupt depends on phase angle (TMR0 is set by phase angle)
+#endif
     {
         if(FanOn){
             TriacOn();                                  // Triac triggered
         }
         T0IF = 0;                                       // Clear flag
-        NOP();
-        NOP();
-        NOP();
-        NOP();
+        _delay(GATE_DELAY);                             // 4 cycles at 4 MHz, as the NOP()s of 0.7
         TriacOff();                                     // Triac off, beacuse already triggered
     }//if(T0IF)
 
     if(TMR1IF)                                          // @ 524ms; This interrupt is not set, but polled
     {                                                   // with other interrupts
         TMR1IF = 0;
+#if T1_POSTSCALE > 1
+        if(++T1Count < T1_POSTSCALE)                    // A tick is T1_POSTSCALE overflows with a faster clock
+            return;
+        T1Count = 0;
+#endif
 #ifdef  TIMER_ENABLE
         if(TimerRunning && (--TimeCounter == 0))        // If timer running, decrement counter
         {
             TimeCounter = TIME_COUNT;                   // Reload counter
             if(--Time == 0)                             // The time expired, switch off fan and counter
             {
+#if defined USAGE_COUNTERS
+                UsageCount[USAGE_EXPIRIES]++;           // At most one a flush, no need to saturate
+#endif
                 OffTimer();                             // Switch off timer
                 FanOn = 0;
             }
         }
 #endif
+#if defined HI_TECH_C
         {
         #asm
         INCFSZ  _EECounter,W                            // Inc eeprom timer, but not beyond 255
         MOVWF   _EECounter
         #endasm
         }
-        if(EECounter == 8)                              // After 4 seconds since clearing the counter
+#else
+        if(EECounter != 255)
+            EECounter++;
+#endif
+#if defined USAGE_COUNTERS
+        UsageTicks++;                                   // Run time, folded in main()
+#endif
+        if(EECounter == EE_WRITE_COUNT)                 // After 4 seconds since clearing the counter
             EEPromWrite = 1;                            // set eeprom write flag
         if(IR05Seconds)                                 // After 0.5 seconds of inactivity
+        {
             IRCmdRepeat = 0;                            // clear the repeat command
+#if defined IR_SAMSUNG || defined IR_RC5 || defined IR_SIRC
+            IRBurst = 0;                                // and end the key press
+#endif
+        }
         IR05Seconds = 1;
     }//if(TMR1IF)
 }
@@ -20,5 +20,63 @@ typedef enum _IR_COMMAND
     PLAY          = 0x43,
     VOL_MINUS     = 0x07,
     VOL_PLUS      = 0x15,
-    EQ            = 0x09
-}IR_COMMAND;                  
\ No newline at end of file
+    EQ            = 0x09,
+    NO_CMD        = 0xFF
+}IR_COMMAND;
+
+// Samsung TV remote
+typedef enum _SAMSUNG_COMMAND
+{
+    SAMSUNG_DIGIT0    = 0x11,
+    SAMSUNG_DIGIT1    = 0x04,
+    SAMSUNG_DIGIT2    = 0x05,
+    SAMSUNG_DIGIT3    = 0x06,
+    SAMSUNG_DIGIT4    = 0x08,
+    SAMSUNG_DIGIT5    = 0x09,
+    SAMSUNG_DIGIT6    = 0x0A,
+    SAMSUNG_DIGIT7    = 0x0C,
+    SAMSUNG_DIGIT8    = 0x0D,
+    SAMSUNG_DIGIT9    = 0x0E,
+    SAMSUNG_VOL_PLUS  = 0x07,
+    SAMSUNG_VOL_MINUS = 0x0B,
+    SAMSUNG_CH_PLUS   = 0x12,
+    SAMSUNG_CH_MINUS  = 0x10
+}SAMSUNG_COMMAND;
+
+// Philips RC5 TV remote
+typedef enum _RC5_COMMAND
+{
+    RC5_DIGIT0    = 0x00,
+    RC5_DIGIT1    = 0x01,
+    RC5_DIGIT2    = 0x02,
+    RC5_DIGIT3    = 0x03,
+    RC5_DIGIT4    = 0x04,
+    RC5_DIGIT5    = 0x05,
+    RC5_DIGIT6    = 0x06,
+    RC5_DIGIT7    = 0x07,
+    RC5_DIGIT8    = 0x08,
+    RC5_DIGIT9    = 0x09,
+    RC5_VOL_PLUS  = 0x10,
+    RC5_VOL_MINUS = 0x11,
+    RC5_CH_PLUS   = 0x20,
+    RC5_CH_MINUS  = 0x21
+}RC5_COMMAND;
+
+// Sony SIRC TV remote
+typedef enum _SIRC_COMMAND
+{
+    SIRC_DIGIT0    = 0x09,
+    SIRC_DIGIT1    = 0x00,
+    SIRC_DIGIT2    = 0x01,
+    SIRC_DIGIT3    = 0x02,
+    SIRC_DIGIT4    = 0x03,
+    SIRC_DIGIT5    = 0x04,
+    SIRC_DIGIT6    = 0x05,
+    SIRC_DIGIT7    = 0x06,
+    SIRC_DIGIT8    = 0x07,
+    SIRC_DIGIT9    = 0x08,
+    SIRC_CH_PLUS   = 0x10,
+    SIRC_CH_MINUS  = 0x11,
+    SIRC_VOL_PLUS  = 0x12,
+    SIRC_VOL_MINUS = 0x13
+}SIRC_COMMAND;
\ No newline at end of file
@@ -0,0 +1,86 @@
+/********************************************************************************
+*   Speed tables, generated by tools/stable.c - do not edit                     *
+*   Mains 230V 50Hz, TMR0 1:64 at 4MHz, speed 1 at 25% power or more           *
+*   Entries are TMR0 delays in us, PHASE_ANGLE() in main.c sets them for the    *
+*   clock. Select one with LOAD_PROFILE in main.c. BTable is the power of the   *
+*   speeds in % for BURST_FIRE, full speed is always on the phase angle         *
+*********************************************************************************/
+#define STABLE_MAINS    50
+#if MAINS_FREQ != STABLE_MAINS
+#error "stable.h is for other mains, run tools/stable -f"
+#endif
+#define LOAD_TABLE      1
+#define LOAD_CEILING    2
+#define LOAD_EXHAUST    3
+
+#if LOAD_PROFILE == LOAD_TABLE
+// 50W table / pedestal fan, pf 0.90, TRIAC latch 25mA hold 15mA, speed 1 at 26% power
+// Speed  TMR0  Delay(us)  Power(W)  Speed(%)
+//   1    167      5704      12.9      63.6
+//   2    172      5384      15.8      68.1
+//   3    177      5064      19.0      72.4
+//   4    183      4680      23.0      77.2
+//   5    189      4296      27.1      81.6
+//   6    196      3848      31.9      86.1
+//   7    205      3272      37.8      91.1
+//   8    215      2632      43.5      95.5
+//   9    230      1672      50.0     100.0
+#define PHASE_LONGEST   5696
+#define PHASE_SHORTEST  1664
+const unsigned char STable[10] = {0,
+    PHASE_ANGLE(PHASE_LONGEST), PHASE_ANGLE(5376), PHASE_ANGLE(5056), PHASE_ANGLE(4672), PHASE_ANGLE(4288),
+    PHASE_ANGLE(3840), PHASE_ANGLE(3264), PHASE_ANGLE(2624), PHASE_ANGLE(PHASE_SHORTEST)};
+#if defined BURST_FIRE
+const unsigned char BTable[10] = {0,
+    BURST_POWER(26), BURST_POWER(32), BURST_POWER(38), BURST_POWER(46), BURST_POWER(54),
+    BURST_POWER(64), BURST_POWER(76), BURST_POWER(87), 0};
+#endif
+
+#elif LOAD_PROFILE == LOAD_CEILING
+// 75W ceiling fan, pf 0.95, TRIAC latch 25mA hold 15mA, speed 1 at 26% power
+// Speed  TMR0  Delay(us)  Power(W)  Speed(%)
+//   1    165      5832      19.2      63.5
+//   2    170      5512      23.5      67.9
+//   3    176      5128      29.0      72.9
+//   4    182      4744      34.9      77.5
+//   5    188      4360      40.8      81.6
+//   6    196      3848      48.6      86.5
+//   7    204      3336      55.9      90.7
+//   8    216      2568      65.1      95.4
+//   9    237      1224      75.0     100.0
+#define PHASE_LONGEST   5824
+#define PHASE_SHORTEST  1216
+const unsigned char STable[10] = {0,
+    PHASE_ANGLE(PHASE_LONGEST), PHASE_ANGLE(5504), PHASE_ANGLE(5120), PHASE_ANGLE(4736), PHASE_ANGLE(4352),
+    PHASE_ANGLE(3840), PHASE_ANGLE(3328), PHASE_ANGLE(2560), PHASE_ANGLE(PHASE_SHORTEST)};
+#if defined BURST_FIRE
+const unsigned char BTable[10] = {0,
+    BURST_POWER(26), BURST_POWER(31), BURST_POWER(39), BURST_POWER(47), BURST_POWER(54),
+    BURST_POWER(65), BURST_POWER(75), BURST_POWER(87), 0};
+#endif
+
+#elif LOAD_PROFILE == LOAD_EXHAUST
+// 120W exhaust / industrial fan, pf 0.85, TRIAC latch 25mA hold 15mA, speed 1 at 26% power
+// Speed  TMR0  Delay(us)  Power(W)  Speed(%)
+//   1    168      5640      30.9      63.6
+//   2    173      5320      38.1      68.2
+//   3    178      5000      45.9      72.6
+//   4    184      4616      55.8      77.5
+//   5    190      4232      66.0      81.9
+//   6    197      3784      78.0      86.6
+//   7    204      3336      89.5      90.7
+//   8    214      2696     104.6      95.5
+//   9    226      1928     120.0     100.0
+#define PHASE_LONGEST   5632
+#define PHASE_SHORTEST  1920
+const unsigned char STable[10] = {0,
+    PHASE_ANGLE(PHASE_LONGEST), PHASE_ANGLE(5312), PHASE_ANGLE(4992), PHASE_ANGLE(4608), PHASE_ANGLE(4224),
+    PHASE_ANGLE(3776), PHASE_ANGLE(3328), PHASE_ANGLE(2688), PHASE_ANGLE(PHASE_SHORTEST)};
+#if defined BURST_FIRE
+const unsigned char BTable[10] = {0,
+    BURST_POWER(26), BURST_POWER(32), BURST_POWER(38), BURST_POWER(46), BURST_POWER(55),
+    BURST_POWER(65), BURST_POWER(75), BURST_POWER(87), 0};
+#endif
+#else
+#error "Unknown LOAD_PROFILE"
+#endif
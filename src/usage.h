@@ -0,0 +1,36 @@
+/********************************************************************************
+*               Usage and health counters, EEPROM layout                        *
+*                                                                               *
+*   Shared by the firmware and tools/usage.c. The counters are little endian.   *
+*   The firmware keeps the counts in RAM and adds them to the EEPROM with the   *
+*   settings, on CH, a minute into a run the settings did not save (a power on) *
+*   and every USAGE_FLUSH minutes of running. Turning the fan off at the wall   *
+*   loses the counts since the last of these, at most USAGE_FLUSH minutes.      *
+*                                                                               *
+*   Wear: a flush writes a cell once at most, and the low bytes change on most. *
+*   Beyond the settings writes, the flushes add the EE_WRITES count and the     *
+*   other counters on each save, and writes of their own for CH, power ons and  *
+*   run hours. At ten saves, two power ons and 8 hours running a day, that is   *
+*   20 a day: the 100k cycles (minimum) of the data EEPROM last 13 years, and   *
+*   running 24 hours a day 11 years (1M typical, ten times as long). Non-stop   *
+*   key presses, one save in 4 s, would wear a cell out in 4.6 days.            *
+*                                                                               *
+*********************************************************************************/
+
+#define EE_RUN_MINUTES      0x08            // Run time at speed 1-9, in minutes, 3 bytes each
+#define EE_COUNTS           0x23            // The counts below, 2 bytes each
+#define EE_WRITES           0x2D            // Settings writes, 2 bytes
+#define EE_USAGE_VERSION    0x2F
+#define USAGE_VERSION       1
+#define USAGE_FLUSH         60              // Minutes of running between the saves of the counters
+
+// Counts kept in RAM as bytes, each added to the 2 byte counter at EE_COUNTS + 2 x index
+
+#define USAGE_STARTS        0               // Fan starts
+#define USAGE_EXPIRIES      1               // Timer expiries
+#define USAGE_IR_FRAMES     2               // IR frames decoded
+#define USAGE_IR_REJECTS    3               // IR frames given up by the NEC decoder (Error)
+#define USAGE_UNKNOWN       4               // Unknown commands
+#define USAGE_COUNTS        5
+
+#define USAGE_SHOWN         15              // Counters blinked by the service key: the run times, the counts and the writes
@@ -0,0 +1,393 @@
+/********************************************************************************
+*                   IR Capture Decoder (host tool)                              *
+*                                                                               *
+*   This program is free software: you can redistribute it and/or modify        *
+*   it under the terms of the GNU General Public License as published by        *
+*   the Free Software Foundation, either version 3 of the License, or           *
+*   (at your option) any later version.                                         *
+*                                                                               *
+*   This program is distributed in the hope that it will be useful,             *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+*   GNU General Public License for more details.                                *
+*                                                                               *
+*   You should have received a copy of the GNU General Public License           *
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+*                                                                               *
+*       Processor       : Host PC (POSIX, 64 bit)                               *
+*                                                                               *
+*   Decodes logic analyser captures of the IR receiver output (GP3) with the    *
+*   same pulse classes as IRDecoder() and the same NEC rules as NECDecoder()    *
+*   in the firmware. The capture is mapped a window at a time, so any file      *
+*   size is decoded with constant memory.                                       *
+*                                                                               *
+*   Build   : cc -O2 -march=native -I../src -o irdecode irdecode.c              *
+*             add -DIR_CLOCK=625000 for a firmware built for 20 MHz             *
+*   Usage   : irdecode -r rate [-c ch] [-p] [-i] [-e edges.txt] capture.bin     *
+*       -r  Sample rate in Hz                                                   *
+*       -c  Channel (bit 0-7) of the IR line in byte samples, default 0         *
+*       -p  Packed capture, one bit per sample, LSB first                       *
+*       -i  Invert the samples (probe on the active high side)                  *
+*       -e  Write the edge list (time in ns and GP3 level) for the simulator    *
+*                                                                               *
+*********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined __SSE2__
+#include <emmintrin.h>
+#endif
+#include "ir_timing.h"
+
+#define WINDOW_SIZE     (64UL << 20)    // Bytes mapped at a time, a multiple of the page and block size
+
+// NEC IR protocol states, as in the firmware
+typedef enum _NEC_STATES
+{
+    IR_IDLE,
+    IR_MARK,
+    IR_SPACE,
+    IR_HIGH,
+    IR_LOW,
+    IR_REPEAT
+} NEC_STATES;
+
+static const char *StateName[] = {"IDLE", "MARK", "SPACE", "HIGH", "LOW", "REPEAT"};
+
+// IR pulse classes, in the order of the time, as in the firmware
+typedef enum _IR_PULSE
+{
+    PULSE_NOISE,
+    PULSE_560,
+    PULSE_890,
+    PULSE_1200,
+    PULSE_1690,
+    PULSE_2000,
+    PULSE_2250,
+    PULSE_4500,
+    PULSE_9000,
+    PULSE_IDLE
+} IR_PULSE;
+
+// V A R I A B L E S
+static uint64_t Rate;                   // Samples per second
+static unsigned Channel, Invert, Packed;
+static FILE *EdgeFile;
+
+static uint64_t Sample;                 // Index of the first sample in the current word
+static uint64_t LastBit;                // Level of the previous sample
+static uint64_t Edges, Frames, Repeats, Rejects;
+
+static NEC_STATES IRState;
+static unsigned IRDataCount;
+static uint32_t IRData;
+static uint16_t PrevIRTimer;
+
+// F U N C T I O N S
+/**
+Sample index to nanoseconds, without overflowing on long captures
+*/
+static uint64_t SampleToNs(uint64_t n)
+{
+    return (n / Rate) * 1000000000ULL + (n % Rate) * 1000000000ULL / Rate;
+}
+/**
+Sample index to Timer 1 ticks, split the same way; only the low 16 bits are used
+*/
+static uint64_t SampleToTicks(uint64_t n)
+{
+    return (n / Rate) * IR_CLOCK + (n % Rate) * IR_CLOCK / Rate;
+}
+/**
+Report a rejected pulse, the state is the one that found the pulse bad
+*/
+static void Reject(uint64_t ns, NEC_STATES State, uint16_t IRBitTime)
+{
+    Rejects++;
+    printf("%.6f REJECT %-6s %.0fus\n", ns / 1e9, StateName[State], IRBitTime * 1e6 / IR_CLOCK);
+}
+/**
+Pulse class of an edge interval, as in IRDecoder()
+*/
+static IR_PULSE Classify(uint16_t IRBitTime)
+{
+    if(IRBitTime >= IR_IDLE_TIME)
+        return PULSE_IDLE;
+    if(IRBitTime > PULSE_4500_MAX)
+        return PULSE_9000;
+    if(IRBitTime > PULSE_2250_MAX)
+        return PULSE_4500;
+    if(IRBitTime > PULSE_2000_MAX)
+        return PULSE_2250;
+    if(IRBitTime > PULSE_1690_MAX)
+        return PULSE_2000;
+    if(IRBitTime > PULSE_1200_MAX)
+        return PULSE_1690;
+    if(IRBitTime > PULSE_890_MAX)
+        return PULSE_1200;
+    if(IRBitTime > PULSE_560_MAX)
+        return PULSE_890;
+    if(IRBitTime >= MIN_IR_BIT_TIME)
+        return PULSE_560;
+    return PULSE_NOISE;
+}
+/**
+Decode an IR line change at sample n, a step by step copy of NECDecoder() fed with a
+Timer 1 snapshot
+*/
+static void NECEdge(uint64_t n, unsigned Level)
+{
+    uint64_t ns = SampleToNs(n);
+    uint16_t IRTime, IRBitTime;
+    NEC_STATES State;
+    IR_PULSE IRPulse;
+    int Error;
+
+    IRTime = (uint16_t)SampleToTicks(n);                // Timer 1 runs free, so only 16 bits are kept
+    IRBitTime = IRTime - PrevIRTimer;
+    PrevIRTimer = IRTime;
+    IRPulse = Classify(IRBitTime);
+    if(IRPulse == PULSE_IDLE)
+        IRState = IR_IDLE;                              // Idle for more than 16 ms
+    Error = 0;
+    State = IRState;
+    switch(IRState)
+    {
+        case IR_IDLE:
+        if(Level == 0)                                  // Inverted logic, a low is the IR mark
+            IRState = IR_MARK;
+        IRDataCount = 0;
+        IRData = 0;
+        break;
+
+        case IR_MARK:
+        if(IRPulse != PULSE_9000)
+            Error = 1;
+        IRState = IR_SPACE;
+        break;
+
+        case IR_SPACE:
+        if(IRPulse < PULSE_2000)
+            Error = 1;
+        if(IRPulse <= PULSE_2250)
+        {
+            IRState = IR_REPEAT;
+            break;
+        }
+        IRState = IR_HIGH;
+        break;
+
+        case IR_HIGH:
+        if(IRPulse != PULSE_560)
+            Error = 1;
+        IRState = IR_LOW;
+        break;
+
+        case IR_LOW:
+        if((IRPulse == PULSE_NOISE) || (IRPulse > PULSE_2000))
+            Error = 1;
+        IRData >>= 1;
+        if(IRPulse >= PULSE_1690)
+            IRData |= 0x80000000;
+        IRDataCount++;
+        IRState = IR_HIGH;
+        break;
+
+        case IR_REPEAT:
+        if(IRPulse != PULSE_560)
+            Error = 1;
+        else
+        {
+            Repeats++;
+            printf("%.6f REPEAT\n", ns / 1e9);
+        }
+        IRState = IR_IDLE;
+        break;
+    }
+    if(Error)
+    {
+        Reject(ns, State, IRBitTime);
+        IRState = IR_IDLE;                              // InitIR()
+        IRDataCount = 0;
+    }
+    if(IRDataCount == 32)
+    {
+        unsigned char b0 = IRData, b1 = IRData >> 8, b2 = IRData >> 16, b3 = IRData >> 24;
+        Frames++;
+        printf("%.6f FRAME  %02X %02X %02X %02X %s\n", ns / 1e9, b0, b1, b2, b3,
+               ((b0 ^ b1) && b0 == 0 && (b2 ^ b3)) ? "accepted" : "ignored");
+        IRState = IR_IDLE;
+        IRDataCount = 0;
+    }
+}
+/**
+A change found on the IR line at the given sample
+*/
+static void Edge(uint64_t n, unsigned Level)
+{
+    Edges++;
+    if(EdgeFile)
+        fprintf(EdgeFile, "%llu %u\n", (unsigned long long)SampleToNs(n), Level);
+    NECEdge(n, Level);
+}
+/**
+Find the changes in 64 packed samples. A word without a change costs a shift and an xor,
+otherwise each change is found by a bit scan
+*/
+static void ScanWord(uint64_t w)
+{
+    uint64_t Changes;
+
+    if(Invert)
+        w = ~w;
+    Changes = w ^ ((w << 1) | LastBit);
+    LastBit = w >> 63;
+    while(Changes)
+    {
+        unsigned i = __builtin_ctzll(Changes);
+        Edge(Sample + i, (w >> i) & 1);
+        Changes &= Changes - 1;                         // Clear the lowest change
+    }
+    Sample += 64;
+}
+/**
+Gather the channel bit of 64 byte samples into one packed word
+*/
+static uint64_t PackBytes(const unsigned char *p)
+{
+    uint64_t w = 0;
+    unsigned i;
+#if defined __SSE2__
+    __m128i Shift = _mm_cvtsi32_si128(7 - Channel);
+    for(i = 0; i < 4; i++)                              // Channel bit to the sign bit, then 16 samples a move mask
+    {
+        __m128i v = _mm_sll_epi16(_mm_loadu_si128((const __m128i *)(p + 16 * i)), Shift);
+        w |= (uint64_t)(uint16_t)_mm_movemask_epi8(v) << (16 * i);
+    }
+#else
+    for(i = 0; i < 8; i++)                              // 8 samples a multiply, byte k to bit 56 + k
+    {
+        uint64_t v;
+        memcpy(&v, p + 8 * i, 8);
+        v = (v >> Channel) & 0x0101010101010101ULL;
+        w |= ((v * 0x0102040810204080ULL) >> 56) << (8 * i);
+    }
+#endif
+    return w;
+}
+/**
+Samples left over at the end of the file, one at a time
+*/
+static void ScanTail(const unsigned char *p, size_t Len)
+{
+    size_t i;
+    uint64_t n = Packed ? Len * 8 : Len;
+
+    for(i = 0; i < n; i++)
+    {
+        unsigned Bit = Packed ? (p[i >> 3] >> (i & 7)) & 1 : (p[i] >> Channel) & 1;
+        Bit ^= Invert;
+        if(Bit != LastBit)
+            Edge(Sample + i, Bit);
+        LastBit = Bit;
+    }
+    Sample += n;
+}
+/**
+Decode one mapped window of the capture
+*/
+static void ScanWindow(const unsigned char *p, size_t Len)
+{
+    size_t i, Blocks = Len / (Packed ? 8 : 64);
+
+    for(i = 0; i < Blocks; i++)
+    {
+        uint64_t w;
+        if(Packed)
+            memcpy(&w, p + 8 * i, 8);
+        else
+            w = PackBytes(p + 64 * i);
+        ScanWord(w);
+    }
+    ScanTail(p + Blocks * (Packed ? 8 : 64), Len - Blocks * (Packed ? 8 : 64));
+}
+
+static void Usage(void)
+{
+    fprintf(stderr, "usage: irdecode -r rate [-c ch] [-p] [-i] [-e edges.txt] capture.bin\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    struct stat st;
+    struct timespec t0, t1;
+    off_t Offset;
+    double Secs;
+    int c, fd;
+
+    while((c = getopt(argc, argv, "r:c:pie:")) != -1)
+    {
+        switch(c)
+        {
+            case 'r': Rate = strtoull(optarg, NULL, 0); break;
+            case 'c': Channel = atoi(optarg) & 7; break;
+            case 'p': Packed = 1; break;
+            case 'i': Invert = 1; break;
+            case 'e':
+            if((EdgeFile = fopen(optarg, "w")) == NULL)
+            {
+                perror(optarg);
+                return 1;
+            }
+            fprintf(EdgeFile, "# time_ns gp3\n");
+            break;
+            default: Usage();
+        }
+    }
+    if(Rate == 0 || optind != argc - 1)
+        Usage();
+    if((fd = open(argv[optind], O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    if(st.st_size > 0)                                  // The line level before the first sample is the first sample
+    {
+        unsigned char b;
+        if(pread(fd, &b, 1, 0) == 1)
+            LastBit = ((Packed ? b : b >> Channel) & 1) ^ Invert;
+    }
+    IRState = IR_IDLE;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(Offset = 0; Offset < st.st_size; Offset += WINDOW_SIZE)
+    {
+        size_t Len = st.st_size - Offset < (off_t)WINDOW_SIZE ? (size_t)(st.st_size - Offset) : WINDOW_SIZE;
+        unsigned char *p = mmap(NULL, Len, PROT_READ, MAP_PRIVATE, fd, Offset);
+        if(p == MAP_FAILED)
+        {
+            perror("mmap");
+            return 1;
+        }
+        madvise(p, Len, MADV_SEQUENTIAL);
+        ScanWindow(p, Len);
+        munmap(p, Len);                                 // Drop the window, memory stays constant
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    close(fd);
+    if(EdgeFile)
+        fclose(EdgeFile);
+
+    Secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    fprintf(stderr, "%llu samples (%.3f s), %llu edges, %llu frames, %llu repeats, %llu rejects, %.0f MB/s\n",
+            (unsigned long long)Sample, SampleToNs(Sample) / 1e9, (unsigned long long)Edges,
+            (unsigned long long)Frames, (unsigned long long)Repeats, (unsigned long long)Rejects,
+            Secs > 0 ? st.st_size / Secs / 1e6 : 0.0);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# Build matrix: every supported chip and clock, and every IR protocol, is built into the
+# simulator and run with a key press (digit 2, speed 2) on its remote, which must be decoded
+# and saved to EEPROM; the IR decode cost of the sim model is shown for each. The firmware
+# is built as well when the HI-TECH compiler (picc) is on the path; the hex files and the
+# compiler output (with the flash used) go to build/ of this directory. The default build
+# is run in lockstep with the 0.7 HEX, on key presses and randomized scenarios,
+# and a BURST_FIRE build through all speeds, the burst fired ones without TMR0 interrupts.
+# The scenarios are run unsteered as well, their IR edges left at the decoder limits where
+# the outcome hangs on a cycle the host model does not time. A divergence fails unless it is
+# put down to a hazard, and the steered run must have some of the frames this decoder takes
+# apart from 0.7 by design (a 16 ms gap, a bit time of 256 counts), so the check sees them.
+#
+#   Usage : ./matrix.sh [extra cc/picc options, e.g. -DIR_CAPTURE_INT]
+#
+cd "$(dirname "$0")" || exit 1
+Fail=0
+Warn="-O2 -Wall -Wextra -Werror"                         # The host tools stay warning clean
+for Build in 12F675:4000000 16F676:4000000 16F676:20000000 12F675:4000000:SAMSUNG 12F675:4000000:RC5 \
+             12F675:4000000:SIRC
+do
+    Chip=${Build%%:*}
+    Clock=${Build#*:}
+    Ir=${Clock#*:}
+    Clock=${Clock%%:*}
+    Name=${Chip}_$((Clock / 1000000))MHz
+    Proto=nec
+    Opt=
+    if [ "$Ir" != "$Clock" ]
+    then
+        case " $* " in *IR_CAPTURE_INT*) continue;; esac    # NEC only
+        Name=${Name}_$Ir
+        Proto=$(echo $Ir | tr A-Z a-z)
+        Opt=-DIR_$Ir
+    fi
+    if command -v picc > /dev/null
+    then
+        mkdir -p build
+        picc --chip=$Chip -D_XTAL_FREQ=$Clock $Opt "$@" --outdir=build -O$Name ../../src/main.c > build/$Name.txt 2>&1 || Fail=1
+        sed -n 's/^ *Program space *\(.*\)/'"$Name"' flash \1/p' build/$Name.txt
+    fi
+    cc $Warn -I. -I../../src -D_$Chip -D_XTAL_FREQ=$Clock $Opt "$@" -o sim_$Name sim.c pic14.c -lm || { Fail=1; continue; }
+    Result=$(./sim_$Name -t 10 -c 0x18 -k 1 -i $Proto)
+    echo "$Result" | sed -n 's/^\(Chip\|Interrupts\|IR decode\|State\) *: /'"$Name"' /p'
+    echo "$Result" | grep -q "Speed 2,.*EEPROM writes [1-9][0-9]*$" || { echo "$Name: FAILED"; Fail=1; }
+done
+# The default build in lockstep with the installed 0.7 HEX, for the default options only
+if [ $# -eq 0 ]
+then
+    cc $Warn -I. -I../../src -o sim_lockstep sim.c pic14.c -lm || exit 1
+    Result=$(./sim_lockstep -x ../../bin/FanController0v7.hex -t 20 -p 0.7 -c 0x18,0x0D,0x19,0x45)
+    echo "$Result" | sed -n 's/^Lockstep *: /lockstep /p'
+    echo "$Result" | grep -q "no divergence" || { echo "$Result" | sed -n '/^Divergence/,/^Stimulus/p'; Fail=1; }
+    for Run in steered unsteered
+    do
+        Result=$(./sim_lockstep -x ../../bin/FanController0v7.hex -z 1 -r 20 $([ $Run = unsteered ] && echo -u))
+        echo "$Result" | sed -n 's/^\(Scenarios\|Steering\) *: /'"$Run"' /p;s/^Explained *: \([a-z]* [0-9]\)/'"$Run"' explained \1/p'
+        echo "$Result" | grep -q "^Scenarios .* 0 failed$" || { echo "$Result" | sed -n '/^Divergence/,/^Explained/p'; Fail=1; }
+        [ $Run = steered ] && Steered=$Result
+    done
+    echo "$Steered" | grep -q "idle [1-9][0-9]*, byte [1-9]" || { echo "lockstep: FAILED, no 16 ms gap or long bit time"; Fail=1; }
+    cc $Warn -I. -I../../src -DBURST_FIRE=3 -o sim_burst sim.c pic14.c -lm || exit 1
+    Result=$(./sim_burst -t 22 -p 2 -c 0x0C,0x18,0x5E,0x08,0x1C,0x5A,0x42,0x52,0x4A)
+    echo "$Result" | sed -n '/^Per speed/,/^State/{/^State/d;s/^Per speed *: /burst /;s/^  */burst /;p}'
+    [ "$(echo "$Result" | awk '$1 <= 3 && $2 == "burst" && $5 == 0' | wc -l)" -eq 3 ] || { echo "burst: FAILED"; Fail=1; }
+fi
+exit $Fail
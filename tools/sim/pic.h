@@ -0,0 +1,84 @@
+/********************************************************************************
+*               pic.h for the host simulator                                    *
+*                                                                               *
+*   Stands in for the HI-TECH C pic.h when src/main.c is built into sim.c.      *
+*   The special function registers are plain variables; the timers, EEPROM     *
+*   and delays call into the simulator, which keeps the time and runs isr()     *
+*   on the interrupts.                                                          *
+*                                                                               *
+*********************************************************************************/
+#define SIM
+#if !defined _16F676 && !defined _12F675
+#define _12F675
+#endif
+
+#define near
+#define interrupt
+#define __CONFIG(x)
+#define __IDLOC7(a, b, c, d)
+// Each __EEPROM_DATA() is a constructor placing its 8 bytes after the previous ones
+#define SIM_EE_DATA(n, ...)     static void __attribute__((constructor)) SimEEData##n(void) \
+    { static const unsigned char d[8] = {__VA_ARGS__}; SimEEData(n, d); }
+#define SIM_EE(n, ...)          SIM_EE_DATA(n, __VA_ARGS__)
+#define __EEPROM_DATA(a, b, c, d, e, f, g, h)   SIM_EE(__COUNTER__, a, b, c, d, e, f, g, h)
+
+typedef union _SIM_REG
+{
+    unsigned char Byte;
+    struct
+    {
+        unsigned Bit0:1;
+        unsigned Bit1:1;
+        unsigned Bit2:1;
+        unsigned Bit3:1;
+        unsigned Bit4:1;
+        unsigned Bit5:1;
+        unsigned Bit6:1;
+        unsigned Bit7:1;
+    } Bits;
+} SIM_REG;
+
+extern volatile SIM_REG SimGPIO, SimPORTC, SimINTCON, SimPIR1;
+extern volatile unsigned char TRISIO, TRISC, WPU, IOC, ANSEL, CMCON, OPTION, T1CON, OSCCAL, PIE1, VRCON;
+
+#define GPIO            SimGPIO.Byte
+#define GPIO0           SimGPIO.Bits.Bit0
+#define GPIO1           SimGPIO.Bits.Bit1
+#define GPIO2           SimGPIO.Bits.Bit2
+#define GPIO3           SimGPIO.Bits.Bit3
+#define GPIO4           SimGPIO.Bits.Bit4
+#define GPIO5           SimGPIO.Bits.Bit5
+#define PORTC           SimPORTC.Byte   // 16F676
+#define RC0             SimPORTC.Bits.Bit0
+#define INTCON          SimINTCON.Byte
+#define GIE             SimINTCON.Bits.Bit7
+#define PEIE            SimINTCON.Bits.Bit6
+#define T0IE            SimINTCON.Bits.Bit5
+#define INTE            SimINTCON.Bits.Bit4
+#define GPIE            SimINTCON.Bits.Bit3
+#define T0IF            SimINTCON.Bits.Bit2
+#define INTF            SimINTCON.Bits.Bit1
+#define GPIF            SimINTCON.Bits.Bit0
+#define PIR1            SimPIR1.Byte
+#define TMR1IF          SimPIR1.Bits.Bit0
+
+// Timers run on the simulated time, an access is a call
+#define TMR0            (*SimTMR0())
+#define TMR1L           (*SimTMR1(0))
+#define TMR1H           (*SimTMR1(1))
+#define WR              SimWR()         // EECON1, an eeprom write in progress
+
+#define _READ_OSCCAL_DATA()     0x80
+#define NOP()                   _delay(1)
+#define DELAY_LOOP_CYCLES       4       // The loop around a __delay_ms(), its counter and GOTO
+#define __delay_ms(x)           _delay((unsigned long)((x) * (_XTAL_FREQ / 4000.0)) + DELAY_LOOP_CYCLES)
+#define __delay_us(x)           _delay((unsigned long)((x) * (_XTAL_FREQ / 4000000.0)))
+
+volatile unsigned char *SimTMR0(void);
+volatile unsigned char *SimTMR1(unsigned char Byte);
+void _delay(unsigned long Cycles);
+unsigned char eeprom_read(unsigned char Addr);
+void eeprom_write(unsigned char Addr, unsigned char Value);
+unsigned char SimWR(void);
+void SimLoop(void);
+void SimEEData(unsigned Block, const unsigned char *Data);
@@ -0,0 +1,408 @@
+/********************************************************************************
+*               PIC12F675 instruction set emulator                              *
+*                                                                               *
+*   This program is free software: you can redistribute it and/or modify        *
+*   it under the terms of the GNU General Public License as published by        *
+*   the Free Software Foundation, either version 3 of the License, or           *
+*   (at your option) any later version.                                         *
+*                                                                               *
+*   This program is distributed in the hope that it will be useful,             *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+*   GNU General Public License for more details.                                *
+*                                                                               *
+*   You should have received a copy of the GNU General Public License           *
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+*                                                                               *
+*       Processor       : Host PC                                               *
+*                                                                               *
+*   The 35 mid-range instructions with their cycles, the banked register file,  *
+*   the 8 level stack and the interrupt entry. The peripherals run on the       *
+*   instruction cycles: TMR0 with its prescaler and the 2 cycle inhibit after a *
+*   write, Timer 1 on the internal clock, the GPIO change mismatch latched on a *
+*   port read, the INT edge, and the EEPROM with its unlock sequence and write  *
+*   time. See pic14.h.                                                          *
+*                                                                               *
+*********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "pic14.h"
+
+#define C_BIT           0x01
+#define DC_BIT          0x02
+#define Z_BIT           0x04
+#define RP0_BIT         0x20
+
+#define REG(a)          p->Ram[PIC14_##a]
+/**
+The register at an address, the ones of both banks and the GPRs (mirrored on the 12F675)
+live at their bank 0 address
+*/
+static unsigned Map(unsigned a)
+{
+    unsigned f = a & 0x7F;
+
+    if(f >= 0x20 || f == PIC14_INDF || f == PIC14_PCL || f == PIC14_STATUS || f == PIC14_FSR ||
+       f == PIC14_PCLATH || f == PIC14_INTCON)
+        return f;
+    return a & 0xFF;
+}
+/**
+GPIO as read: the latch on the outputs, the driven level on the inputs, GP3 is always an input
+*/
+static unsigned char PortLevels(const PIC14 *p)
+{
+    unsigned char Tris = p->Ram[PIC14_TRISIO] | 0x08;
+
+    return ((p->Ram[PIC14_GPIO] & ~Tris) | (p->Pins & Tris)) & 0x3F;
+}
+
+unsigned char Pic14Port(const PIC14 *p)
+{
+    return PortLevels(p);
+}
+
+static void Tick(PIC14 *p, unsigned n)
+{
+    unsigned char Option = REG(OPTION), T1con = REG(T1CON);
+
+    while(n--)
+    {
+        p->Cycles++;
+        if(p->T0Inhibit)
+            p->T0Inhibit--;
+        else if(!(Option & 0x20) && ((Option & 0x08) || ++p->T0Prescale >= (2u << (Option & 0x07))))
+        {
+            p->T0Prescale = 0;
+            if(++REG(TMR0) == 0)
+                REG(INTCON) |= 0x04;                    // T0IF
+        }
+        if((T1con & 0x03) == 0x01 && ++p->T1Prescale >= (1u << ((T1con >> 4) & 0x03)))
+        {
+            p->T1Prescale = 0;
+            if(++REG(TMR1L) == 0 && ++REG(TMR1H) == 0)
+                REG(PIR1) |= 0x01;                      // TMR1IF
+        }
+    }
+    if(p->EEDone && p->Cycles >= p->EEDone)
+    {
+        p->EEDone = 0;
+        REG(EECON1) &= ~0x02;                           // WR done
+        REG(PIR1) |= 0x80;                              // EEIF
+    }
+}
+
+static unsigned char Read(PIC14 *p, unsigned a)
+{
+    if((a & 0x7F) == PIC14_INDF && (a = REG(FSR)) == PIC14_INDF)
+        return 0;
+    a = Map(a);
+    if(a == PIC14_PCL)
+        return p->Pc & 0xFF;
+    if(a == PIC14_GPIO)
+        return p->PortRead = PortLevels(p);
+    if(a == PIC14_EECON2)
+        return 0;
+    return p->Ram[a];
+}
+
+static void Write(PIC14 *p, unsigned a, unsigned char v)
+{
+    unsigned char Old;
+
+    if((a & 0x7F) == PIC14_INDF && (a = REG(FSR)) == PIC14_INDF)
+        return;
+    a = Map(a);
+    Old = p->Ram[a];
+    switch(a)
+    {
+        case PIC14_TMR0:
+        p->T0Prescale = 0;
+        p->T0Inhibit = 2;
+        break;
+        case PIC14_PCL:
+        p->Pc = REG(PCLATH) << 8 | v;
+        Tick(p, 1);                                     // A computed goto takes 2 cycles
+        break;
+        case PIC14_STATUS:
+        v = (v & ~0x18) | (Old & 0x18);                 // TO and PD are read only
+        break;
+        case PIC14_EECON1:
+        if(v & 0x01)                                    // RD
+            REG(EEDAT) = p->EE[REG(EEADR) & (PIC14_EE_SIZE - 1)];
+        if((v & 0x02) && !(Old & 0x02) && (v & 0x04) && p->EEUnlock == 2)
+        {                                               // WR after the unlock, with WREN
+            p->EE[REG(EEADR) & (PIC14_EE_SIZE - 1)] = REG(EEDAT);
+            p->EEDone = p->Cycles + PIC14_EE_WRITE_NS / p->TcyNs;
+        }
+        else
+            v = (v & ~0x02) | (Old & 0x02);             // WR is only cleared by the hardware
+        v &= ~0x01;
+        p->EEUnlock = 0;
+        break;
+        case PIC14_EECON2:
+        p->EEUnlock = (v == 0x55) ? 1 : (v == 0xAA && p->EEUnlock == 1) ? 2 : 0;
+        return;
+    }
+    p->Ram[a] = v;
+}
+
+static void SetFlags(PIC14 *p, unsigned char Mask, unsigned char Flags)
+{
+    REG(STATUS) = (REG(STATUS) & ~Mask) | (Flags & Mask);
+}
+
+static void Push(PIC14 *p, unsigned short Address)
+{
+    p->Stack[p->Sp] = Address;
+    p->Sp = (p->Sp + 1) & 0x07;
+}
+
+static unsigned short Pop(PIC14 *p)
+{
+    p->Sp = (p->Sp - 1) & 0x07;
+    return p->Stack[p->Sp];
+}
+/**
+Execute one instruction, or enter the interrupt when one is pending
+*/
+void Pic14Step(PIC14 *p)
+{
+    unsigned Op, a, b, r, x, w, k, Cycles = 1;
+    unsigned char Intcon;
+
+    if((PortLevels(p) ^ p->PortRead) & REG(IOC) & (REG(TRISIO) | 0x08))
+        REG(INTCON) |= 0x01;                            // GPIF, set again while the mismatch stays
+    Intcon = REG(INTCON);
+    if((Intcon & 0x80) && ((Intcon & (Intcon >> 3) & 0x07) || ((Intcon & 0x40) && (REG(PIE1) & REG(PIR1)))))
+    {
+        Push(p, p->Pc);
+        REG(INTCON) &= ~0x80;
+        p->Pc = 0x0004;
+        Tick(p, 2);
+        return;
+    }
+
+    Op = p->Rom[p->Pc & (PIC14_ROM_SIZE - 1)];
+    p->Pc = (p->Pc + 1) & 0x1FFF;
+    a = (Op & 0x7F) | (REG(STATUS) & RP0_BIT) << 2;
+    b = 1 << ((Op >> 7) & 0x07);
+    k = Op & 0xFF;
+    w = p->W;
+    switch(Op >> 12)
+    {
+        case 0:                                         // Byte oriented
+        if((Op >> 8) <= 1)
+        {
+            if(Op & 0x0100)                             // CLRF, CLRW
+            {
+                if(Op & 0x80)
+                    Write(p, a, 0);
+                else
+                    p->W = 0;
+                SetFlags(p, Z_BIT, Z_BIT);
+            }
+            else if(Op & 0x80)                          // MOVWF
+                Write(p, a, w);
+            else if(Op == 0x0008)                       // RETURN
+            {
+                p->Pc = Pop(p);
+                Cycles = 2;
+            }
+            else if(Op == 0x0009)                       // RETFIE
+            {
+                p->Pc = Pop(p);
+                REG(INTCON) |= 0x80;
+                Cycles = 2;
+            }
+            break;                                      // NOP, CLRWDT, SLEEP
+        }
+        x = Read(p, a);
+        switch((Op >> 8) & 0x0F)
+        {
+            case 0x2:                                   // SUBWF
+            r = x - w;
+            SetFlags(p, C_BIT | DC_BIT, (x >= w ? C_BIT : 0) | ((x & 0x0F) >= (w & 0x0F) ? DC_BIT : 0));
+            break;
+            case 0x3: r = x - 1; break;                 // DECF
+            case 0x4: r = x | w; break;                 // IORWF
+            case 0x5: r = x & w; break;                 // ANDWF
+            case 0x6: r = x ^ w; break;                 // XORWF
+            case 0x7:                                   // ADDWF
+            r = x + w;
+            SetFlags(p, C_BIT | DC_BIT, (r > 0xFF ? C_BIT : 0) | ((x & 0x0F) + (w & 0x0F) > 0x0F ? DC_BIT : 0));
+            break;
+            case 0x8: r = x; break;                     // MOVF
+            case 0x9: r = ~x; break;                    // COMF
+            case 0xA: r = x + 1; break;                 // INCF
+            case 0xB: r = x - 1; break;                 // DECFSZ
+            case 0xC:                                   // RRF
+            r = x >> 1 | (REG(STATUS) & C_BIT) << 7;
+            SetFlags(p, C_BIT, x & 0x01);
+            break;
+            case 0xD:                                   // RLF
+            r = x << 1 | (REG(STATUS) & C_BIT);
+            SetFlags(p, C_BIT, x >> 7);
+            break;
+            case 0xE: r = x >> 4 | x << 4; break;       // SWAPF
+            default: r = x + 1; break;                  // INCFSZ
+        }
+        r &= 0xFF;
+        if(Op & 0x80)
+            Write(p, a, r);
+        else
+            p->W = r;
+        switch((Op >> 8) & 0x0F)
+        {
+            case 0xB: case 0xF:                         // DECFSZ, INCFSZ skip on zero
+            if(r == 0)
+            {
+                p->Pc = (p->Pc + 1) & 0x1FFF;
+                Cycles = 2;
+            }
+            break;
+            case 0xC: case 0xD: case 0xE:
+            break;
+            default:
+            SetFlags(p, Z_BIT, r == 0 ? Z_BIT : 0);
+        }
+        break;
+
+        case 1:                                         // Bit oriented
+        switch((Op >> 10) & 0x03)
+        {
+            case 0: Write(p, a, Read(p, a) & ~b); break;    // BCF
+            case 1: Write(p, a, Read(p, a) | b); break;     // BSF
+            case 2:                                     // BTFSC
+            case 3:                                     // BTFSS
+            if(!(Read(p, a) & b) == !(Op & 0x0400))
+            {
+                p->Pc = (p->Pc + 1) & 0x1FFF;
+                Cycles = 2;
+            }
+            break;
+        }
+        break;
+
+        case 2:                                         // CALL, GOTO
+        if(!(Op & 0x0800))
+            Push(p, p->Pc);
+        p->Pc = (Op & 0x07FF) | (REG(PCLATH) & 0x18) << 8;
+        Cycles = 2;
+        break;
+
+        default:                                        // Literal
+        switch((Op >> 8) & 0x0F)
+        {
+            case 0x0: case 0x1: case 0x2: case 0x3:     // MOVLW
+            p->W = k;
+            break;
+            case 0x4: case 0x5: case 0x6: case 0x7:     // RETLW
+            p->W = k;
+            p->Pc = Pop(p);
+            Cycles = 2;
+            break;
+            case 0x8: p->W = k | w; break;              // IORLW
+            case 0x9: p->W = k & w; break;              // ANDLW
+            case 0xA: p->W = k ^ w; break;              // XORLW
+            case 0xC: case 0xD:                         // SUBLW
+            p->W = (k - w) & 0xFF;
+            SetFlags(p, C_BIT | DC_BIT, (k >= w ? C_BIT : 0) | ((k & 0x0F) >= (w & 0x0F) ? DC_BIT : 0));
+            break;
+            default:                                    // ADDLW
+            p->W = (k + w) & 0xFF;
+            SetFlags(p, C_BIT | DC_BIT, (k + w > 0xFF ? C_BIT : 0) | ((k & 0x0F) + (w & 0x0F) > 0x0F ? DC_BIT : 0));
+        }
+        if((Op >> 8) >= 0x38)                           // The logic and arithmetic ones set Z
+            SetFlags(p, Z_BIT, p->W == 0 ? Z_BIT : 0);
+    }
+    Tick(p, Cycles);
+}
+/**
+Drive an input pin, with the INT edge on GP2
+*/
+void Pic14SetPin(PIC14 *p, unsigned char Mask, unsigned char Level)
+{
+    unsigned char Old = p->Pins;
+
+    p->Pins = Level ? (Old | Mask) : (Old & ~Mask);
+    if(((Old ^ p->Pins) & 0x04 & REG(TRISIO)) && !(p->Pins & 0x04) == !(REG(OPTION) & 0x40))
+        REG(INTCON) |= 0x02;                            // INTF on the edge selected by INTEDG
+}
+/**
+Power on reset, the program and the EEPROM are kept
+*/
+void Pic14Reset(PIC14 *p, unsigned long Clock)
+{
+    memset(p->Ram, 0, sizeof(p->Ram));
+    memset(p->Stack, 0, sizeof(p->Stack));
+    REG(STATUS) = 0x18;
+    REG(OPTION) = 0xFF;
+    REG(TRISIO) = 0x3F;
+    p->Ram[0x9F] = 0x0F;                                // ANSEL
+    p->Pc = 0;
+    p->Sp = p->W = 0;
+    p->T0Prescale = p->T0Inhibit = p->T1Prescale = 0;
+    p->EEUnlock = 0;
+    p->EEDone = 0;
+    p->Cycles = 0;
+    p->TcyNs = 4000000000ULL / Clock;
+    p->PortRead = PortLevels(p);
+}
+/**
+Load the program and the EEPROM data of an Intel HEX file (byte addresses, as picc writes it)
+*/
+int Pic14LoadHex(PIC14 *p, const char *Name)
+{
+    FILE *f = fopen(Name, "r");
+    char Line[600];
+    unsigned long Upper = 0, Address;
+    unsigned Count, Offset, Type, Byte, Sum, i;
+
+    if(f == NULL)
+    {
+        perror(Name);
+        return -1;
+    }
+    for(i = 0; i < PIC14_ROM_SIZE; i++)
+        p->Rom[i] = 0x3FFF;
+    memset(p->EE, 0xFF, sizeof(p->EE));
+    while(fgets(Line, sizeof(Line), f))
+    {
+        if(Line[0] != ':')
+            continue;
+        if(sscanf(Line + 1, "%2x%4x%2x", &Count, &Offset, &Type) != 3 || strlen(Line) < 11 + Count * 2)
+            break;
+        Sum = Count + (Offset >> 8) + (Offset & 0xFF) + Type;
+        for(i = 0; i <= Count; i++)
+        {
+            sscanf(Line + 9 + i * 2, "%2x", &Byte);
+            Sum += Byte;
+            if(i == Count || Type != 0)
+                continue;
+            Address = Upper + Offset + i;
+            if(Address < 2 * PIC14_ROM_SIZE)
+                p->Rom[Address / 2] = (Address & 1) ? (p->Rom[Address / 2] & 0xFF) | (Byte & 0x3F) << 8 :
+                                                      (p->Rom[Address / 2] & 0x3F00) | Byte;
+            else if(Address >= 0x4200 && Address < 0x4200 + 2 * PIC14_EE_SIZE && !(Address & 1))
+                p->EE[(Address - 0x4200) / 2] = Byte;
+        }
+        if(Sum & 0xFF)
+            break;
+        if(Type == 4 && Count == 2)
+        {
+            sscanf(Line + 9, "%4lx", &Upper);
+            Upper <<= 16;
+        }
+        if(Type == 1)
+        {
+            fclose(f);
+            if(p->Rom[PIC14_ROM_SIZE - 1] == 0x3FFF)
+                p->Rom[PIC14_ROM_SIZE - 1] = 0x3480;    // The calibration RETLW kept by the programmer
+            return 0;
+        }
+    }
+    fclose(f);
+    fprintf(stderr, "%s: bad HEX record\n", Name);
+    return -1;
+}
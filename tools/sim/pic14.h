@@ -0,0 +1,60 @@
+/********************************************************************************
+*               PIC12F675 instruction set emulator                              *
+*                                                                               *
+*   Runs a firmware HEX file (bin/FanController0v7.hex) a cycle at a time,      *
+*   with the GPIO, TMR0, Timer 1, interrupt on change, INT and EEPROM of the    *
+*   12F675. The comparator, A/D, watchdog and sleep are not modelled. Used by   *
+*   the lockstep mode of sim.c.                                                 *
+*                                                                               *
+*********************************************************************************/
+#include <stdint.h>
+
+#define PIC14_ROM_SIZE      1024
+#define PIC14_EE_SIZE       128
+
+// Register file addresses, bank 1 from 0x80
+#define PIC14_INDF          0x00
+#define PIC14_TMR0          0x01
+#define PIC14_PCL           0x02
+#define PIC14_STATUS        0x03
+#define PIC14_FSR           0x04
+#define PIC14_GPIO          0x05
+#define PIC14_PCLATH        0x0A
+#define PIC14_INTCON        0x0B
+#define PIC14_PIR1          0x0C
+#define PIC14_TMR1L         0x0E
+#define PIC14_TMR1H         0x0F
+#define PIC14_T1CON         0x10
+#define PIC14_OPTION        0x81
+#define PIC14_TRISIO        0x85
+#define PIC14_PIE1          0x8C
+#define PIC14_IOC           0x96
+#define PIC14_EEDAT         0x9A
+#define PIC14_EEADR         0x9B
+#define PIC14_EECON1        0x9C
+#define PIC14_EECON2        0x9D
+
+#define PIC14_EE_WRITE_NS   5000000ULL          // EEPROM write time, typical
+
+typedef struct _PIC14
+{
+    unsigned short  Rom[PIC14_ROM_SIZE];
+    unsigned char   Ram[256];                   // By address, the shared ones kept in bank 0
+    unsigned char   EE[PIC14_EE_SIZE];
+    unsigned short  Stack[8];
+    unsigned short  Pc;
+    unsigned char   Sp, W;
+    unsigned char   Pins;                       // Levels driven on the inputs
+    unsigned char   PortRead;                   // GPIO at the last read, for the change interrupt
+    unsigned        T0Prescale, T0Inhibit, T1Prescale;
+    unsigned char   EEUnlock;                   // 0x55 and 0xAA seen on EECON2
+    uint64_t        EEDone;                     // End of the EEPROM write in progress, 0 if none
+    uint64_t        Cycles;
+    uint64_t        TcyNs;                      // Instruction cycle, ns
+} PIC14;
+
+int Pic14LoadHex(PIC14 *p, const char *Name);
+void Pic14Reset(PIC14 *p, unsigned long Clock);
+void Pic14Step(PIC14 *p);
+void Pic14SetPin(PIC14 *p, unsigned char Mask, unsigned char Level);
+unsigned char Pic14Port(const PIC14 *p);
@@ -0,0 +1,1871 @@
+/********************************************************************************
+*                   Fan Controller Simulator (host tool)                        *
+*                                                                               *
+*   This program is free software: you can redistribute it and/or modify        *
+*   it under the terms of the GNU General Public License as published by        *
+*   the Free Software Foundation, either version 3 of the License, or           *
+*   (at your option) any later version.                                         *
+*                                                                               *
+*   This program is distributed in the hope that it will be useful,             *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+*   GNU General Public License for more details.                                *
+*                                                                               *
+*   You should have received a copy of the GNU General Public License           *
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+*                                                                               *
+*       Processor       : Host PC                                               *
+*                                                                               *
+*   Runs src/main.c on the host against pic.h of this directory, with the       *
+*   mains zero cross, the IR sensor and the timers driven on simulated time.    *
+*   The main loop and the delays take time through the hooks in pic.h, the      *
+*   interrupts run isr() at the time they are due, charged with the cycles of   *
+*   the 0.7 listing. Reports the interrupt load and the TRIAC firing jitter,    *
+*   and per speed the interrupts, the power on a resistive load (mean and rms), *
+*   the longest run of half cycles off and the flicker, the peak to peak of the *
+*   power over 100 ms: the burst fired speeds of BURST_FIRE against the phase.  *
+*   The IR decoding in the main loop is costed by its compares (a model, see    *
+*   CMP8_CYCLES), per pulse class and against the NECDecoder() of 0.7; NEC      *
+*   alone (IR_NEC_ONLY) is decoded on the time, the classes are only reported.  *
+*                                                                               *
+*   Lockstep (-x): the same stimuli also drive a HEX file on the 12F675         *
+*   emulator of pic14.c. At every zero cross the TRIAC firing, the LED, Speed,  *
+*   Time, Status, the timer blink count and the EEPROM (not the usage counters, *
+*   0.7 has none) of both are compared, and the first difference that lasts     *
+*   more than LOCKSTEP_SLACK half cycles is reported with a trace of the half   *
+*   cycles and the stimuli before it. -z and -r run randomized scenarios, -r in *
+*   parallel processes, for checking that a refactor or a compiler change keeps *
+*   the behaviour of the installed fans. The CH key (usage counters) is left    *
+*   out, the 0.7 firmware does not have it. The scenarios keep the IR edges off *
+*   the decoder limits and the frames off the timer and zero cross collisions,  *
+*   where the outcome hangs on a cycle the host model does not time; the report *
+*   counts them, -u runs without. A divergence is put down to the hazard just   *
+*   before it, one of those or where this decoder differs from 0.7 by design    *
+*   (HazardText[]); without one it fails.                                       *
+*                                                                               *
+*   Build   : cc -O2 -I. -I../../src -o sim sim.c pic14.c -lm                   *
+*             add -DIR_CAPTURE_INT (or any main.c option) for other builds,     *
+*             -D_16F676 [-D_XTAL_FREQ=...] for the 16F676, matrix.sh runs them  *
+*   Usage   : sim [-t secs] [-f hz] [-c cmd] [-k n] [-p secs] [-i ir] [-n]      *
+*             [-e edges] [-o secs] [-s eeprom.bin]                              *
+*             [-x hex [-z seed] [-r n] [-j n] [-w n] [-u]]                      *
+*       -t  Time to run, default 20 s                                           *
+*       -f  Mains frequency, default 50 Hz                                      *
+*       -c  NEC commands sent in turn (0x18,0x46,...), default 0x55 (not used)  *
+*       -k  Number of key presses from 3 s, default till the end                *
+*       -p  Time between the key presses, default 1 s                           *
+*       -i  Remote of the key presses: nec (default), samsung, rc5 or sirc,     *
+*           the command mapped as the firmware does; its decoder built in       *
+*       -n  No key presses                                                      *
+*       -e  IR edge list (time in ns and level), as written by irdecode -e      *
+*       -o  Time the edge list starts, default 3 s                              *
+*       -s  Write the EEPROM at the end (128 bytes), tools/usage.c reads it     *
+*       -x  Run in lockstep with a HEX file (../../bin/FanController0v7.hex)    *
+*       -z  Randomized scenario of this seed, instead of the key presses        *
+*       -r  Number of randomized scenarios, from the seed of -z (default 1)     *
+*       -j  Scenarios run at the same time, default the number of CPUs          *
+*       -w  Half cycles in the trace of a divergence, default 12                *
+*       -u  Lockstep unsteered, the IR edges left where they fall               *
+*                                                                               *
+*********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "pic14.h"
+
+#define main FirmwareMain
+#include "main.c"
+#undef main
+
+// -- Cycles of the isr() paths, from the 0.7 listing --
+#define ISR_ENTRY_CYCLES    15          // Latency and context save
+#define ISR_EXIT_CYCLES     12          // Context restore and RETFIE
+#define GPIF_CYCLES         9           // Port read and compare
+#define ZC_PRE_CYCLES       2           // Zero cross branch up to the TMR0 load
+#define ZC_CYCLES           18          // Rest of the zero cross branch, key scan
+#define ZC_FAN_CYCLES       14          // Full speed test, with the fan on
+#define IR_PRE_CYCLES       4           // IR branch up to the TMR1H read
+#define TMR1_READ_CYCLES    2           // A TMR1H or TMR1L read and its store
+#define IR_CYCLES           4           // Rest of the Timer 1 snapshot, the TMR1L zero test
+#define T0_CYCLES           7           // TRIAC pulse, without the NOPs
+#define TMR1_CYCLES         35          // Time keeping
+#define TEST_CYCLES         3           // An interrupt flag test, not set: BTFSS and GOTO
+#define LOOP_CYCLES         40          // A pass of the main loop
+#define EE_READ_CYCLES      6
+#define EE_WRITE_CYCLES     20
+#define EE_BUSY_NS          5000000ULL  // Self timed write, 5 ms typical; a read or write waits for it
+#define T1_START_CYCLES     239         // Reset to TMR1ON, the C startup and the port set up
+
+// -- Cycles of the IR decoding in the main loop, a model of its compares; the rest of IRDecoder()
+// and the decoders (the interval, the state, the data bits) is the same as in 0.7 --
+#define CMP8_CYCLES         4           // Byte compare with a constant and the branch
+#define CMP16_CYCLES        8           // Word compare, the high byte and on equal the low byte
+#define HIGH_TEST_CYCLES    3           // High byte zero test and the branch
+#define BIT_TEST_CYCLES     2           // Bit test and the branch, the 16 ms test of 0.7
+#if PULSE_2000_MAX < 0x100
+#define SHORT_CYCLES        CMP8_CYCLES // An IRShort() compare, on the LSB
+#else
+#define SHORT_CYCLES        CMP16_CYCLES
+#endif
+#if (IR_IDLE_TIME & 0xFF) == 0
+#define IDLE_CYCLES         CMP8_CYCLES // IRIdle(), on the MSB
+#else
+#define IDLE_CYCLES         CMP16_CYCLES
+#endif
+#define RC5_CMPS            3           // Compares of a RC5Decoder() state, at the most
+#define SIRC_CMPS           2           // and of a SIRCDecoder() one
+
+// -- Lockstep --
+#define HEX_CLOCK           4000000UL   // The 0.7 HEX: 12F675, internal oscillator
+#define HEX_SPEED           0x42        // RAM of Speed, Status and Time in the 0.7 HEX
+#define HEX_STATUS          0x43
+#define HEX_TIME            0x44
+#define HEX_COUNT           0x2C        // and of Count, the timer blinks
+#define HEX_IR_BIT_TIME     0x24        // and of IRBitTime, PrevIRTimer and IRTime, the IR decoder
+#define HEX_PREV_IR_TIMER   0x26
+#define HEX_IR_TIME         0x28
+#define LOCKSTEP_EE         8           // EEPROM shown in a trace, the settings; all of it is compared
+#define LOCKSTEP_SLACK      4           // Half cycles a difference may last, for the timing of the two models
+#define FIRE_SLACK_US       100         // Firing delay difference allowed, a TMR0 step is 64 us
+#define TRACE_SIZE          256         // Half cycles kept for the trace
+#define STEADY_MARGIN       3           // Timer 1 ticks an IR interval of a scenario keeps from a decoder limit
+#define STEADY_GAP_NS       100000ULL   // Shortest IR interval of a scenario
+#define READ_MIN_CYCLES     12          // From an IR edge to the TMR1L read, at the least (edge in an isr())
+#define READ_MAX_CYCLES     100         // and at the most, behind another interrupt
+#define TICK_BEFORE_NS      2000000ULL  // A frame of a scenario ends this far before a Timer 1 overflow
+#define TICK_AFTER_NS       12000000ULL // or this after it, with a settings write in between
+#define ZC_CLEAR_NS         1000000ULL  // and its last two edges this far from a zero cross
+#define STEADY_SKEW_NS      40000ULL    // A NEC interval of a scenario stays this close to its time
+#define STEADY_STEP_NS      50000ULL    // or the frame moves on by this
+#define ZC_BUSY_BEFORE_NS   30000ULL    // An IR edge from this far before a zero cross
+#define ZC_BUSY_NS          160000ULL   // to this after it may wait out the zero cross and TMR0 interrupts
+#define HOLD_NS             100000ULL   // A gate held over a zero cross and let go before this does not fire the TRIAC
+#define EXPLAIN_NS          200000000ULL // A divergence is put down to a hazard this far before it, a frame and a repeat
+#define EXPLAIN_LED_NS      750000000ULL // and one of the LED, a frame and a timer blink
+#define EXPLAIN_ORDER       3           // Half cycles from an order hazard, a frame end or a switch step
+#define PAIR_COUNTS         32          // A host and a HEX IRTime this close are of the same IR edge
+#define HOST_EDGES          64          // IR edges of the host kept for that, more than in a half cycle
+#define PAIR_NS             30000000ULL // and how far from the HEX decode, the host runs ahead a half cycle
+#define NEC_EDGES           68          // Of a NEC frame, the header, 32 bits and the stop bit
+#define FLICKER_NS          100000000ULL // Power averaged over this for the flicker of a speed
+
+#define DIFF_TRIAC          0x01
+#define DIFF_LED            0x02
+#define DIFF_SPEED          0x04
+#define DIFF_TIME           0x08
+#define DIFF_STATUS         0x10
+#define DIFF_EEPROM         0x20
+#define DIFF_BLINK          0x40
+#define DIFF_FIELDS         7
+
+#define TCY_NS              (4000000000ULL / _XTAL_FREQ)
+#define MS_NS               1000000ULL
+#define SEC_NS              1000000000ULL
+
+typedef struct _PIN_EVENT
+{
+    uint64_t        Time;               // ns
+    unsigned char   Mask;
+    unsigned char   Level;
+} PIN_EVENT;
+
+typedef struct _FIRING
+{
+    uint64_t        Count;
+    double          Sum, SumSq, Min, Max;
+} FIRING;
+
+typedef struct _SPEED_LOAD             // Half cycles of a speed, the kick at the start left out
+{
+    uint64_t        Halves, Isrs, T0s;
+    double          Power;              // Sum of the power of the half cycles, of full on a resistive load
+    unsigned        Gap, MaxGap;        // Half cycles not conducted in a row, the most
+    double          Window, WinMin, WinMax; // Power over FLICKER_NS, the lowest and highest average
+    unsigned        WinHalves, Windows;
+    int             Burst;
+} SPEED_LOAD;
+
+typedef struct _SNAPSHOT                // Observable state at the end of a half cycle
+{
+    int             Fired;
+    unsigned        Delay;              // Firing delay, us
+    unsigned char   Led, Speed, Hours, Status;
+    unsigned char   Blink;              // Count, the LED shows its blinks a step at a time
+    unsigned char   EE[PIC14_EE_SIZE];
+} SNAPSHOT;
+
+typedef struct _HALF_TRACE
+{
+    uint64_t        Time;               // End of the half cycle, ns
+    SNAPSHOT        Host, Hex;
+    unsigned        Diff;
+} HALF_TRACE;
+
+typedef struct _NOTE                    // A stimulus of a randomized scenario
+{
+    uint64_t        Time;
+    char            Text[64];
+} NOTE;
+
+typedef struct _HOST_EDGE               // An IR edge the host decoded, for PairEdge()
+{
+    uint64_t        Time;
+    unsigned short  Snapshot, Interval; // IRTime and the bit time
+    int             Idle;               // The first of a frame, no bit time
+} HOST_EDGE;
+
+typedef struct _HAZARD                  // A stimulus the 0.7 HEX may take apart, see HazardText[]
+{
+    uint64_t        Time;
+    int             Kind;
+} HAZARD;
+
+// V A R I A B L E S
+volatile SIM_REG SimGPIO, SimPORTC, SimINTCON, SimPIR1;
+volatile unsigned char TRISIO, TRISC, WPU, IOC, ANSEL, CMCON, OPTION, T1CON, OSCCAL, PIE1, VRCON;
+
+static uint64_t Now, StopTime, HalfPeriod, NextZc, LastZc;
+static uint64_t Tmr0Base, Tmr0WriteTime, NextT0, NextTmr1;
+static unsigned char Tmr0Reg, Tmr0Written, Tmr1Byte;
+static unsigned char Pins, HalfAngle;                   // Input levels, angle of the half cycle
+static int InIsr, ZcChanged, IrChanged, Gate, Fired;
+static uint64_t FireTime;
+static unsigned NopCount;
+static jmp_buf Stop;
+
+static PIN_EVENT *Events;
+static size_t EventCount, EventNext, EventSize;
+
+static unsigned char EEData[128] = {[0 ... 127] = 0xFF};
+static uint64_t EEWrites, EEBusy;
+
+static uint64_t IsrCount, ZcIsr, IrIsr, T0Isr, Tmr1Isr, IrEdges, Frames;
+static FIRING Firing[256];                              // By PhaseAngle
+static SPEED_LOAD Load[10];                             // By Speed
+static unsigned char HalfSpeed, LoadSpeed;              // Speed of the half cycle (0 off or the kick), of Load
+static int HalfBurst;                                   // The half cycle is burst fired
+static uint64_t HalfIsr, HalfT0;                        // IsrCount and T0Isr at its start
+
+static PIC14 Hex;                                       // Lockstep
+static int Lockstep, Diverged;
+static uint64_t HexZc, HexLastZc, HexFireTime, Halves, Seed, ScenarioSeed;
+static size_t HexEvent;
+static int HexGate, HexFired;
+static HALF_TRACE Trace[TRACE_SIZE];
+static unsigned DiffRun[DIFF_FIELDS], Window = 12;
+static NOTE *Notes;
+static size_t NoteCount, NoteSize;
+static int Steady, Unsteered;                           // Keep the IR edges off the single cycle outcomes
+static uint64_t LastIrEdge, LastIrLate;
+static uint64_t Steered[2];                             // IR edges and NEC frames moved by it
+static HAZARD *Hazards;                                 // Left in by -u, or by design
+static size_t HazardCount, HazardSize;
+static int Cause = -1;                                  // The hazard a divergence is put down to
+static HOST_EDGE HostEdges[HOST_EDGES];                 // The last ones, a ring
+static unsigned HostEdge;
+static int StatsPipe[2] = {-1, -1};                     // Steered[] and the Cause of the scenario processes
+
+static const unsigned IrLimits[] = {MIN_IR_BIT_TIME, PULSE_560_MAX, PULSE_890_MAX, PULSE_1200_MAX, PULSE_1690_MAX,
+    PULSE_2000_MAX, PULSE_2250_MAX, PULSE_4500_MAX, PULSE_9000_MAX, PULSE_11250_MAX, IR_IDLE_TIME};
+
+static const char *DiffName[DIFF_FIELDS] = {"TRIAC", "LED", "Speed", "Time", "Status", "EEPROM", "Blink"};
+
+enum {HAZARD_LIMIT, HAZARD_RACE, HAZARD_ORDER, HAZARD_STEP, HAZARD_IDLE, HAZARD_BYTE, HAZARD_COUNT};
+static const char *HazardName[HAZARD_COUNT] = {"limit", "race", "order", "step", "idle", "byte"};
+static const char *HazardText[HAZARD_COUNT] = {
+    "an IR interval at a decoder limit, its class hangs on a cycle",
+    "TMR1L rolled over in the Timer 1 reads of the HEX, its IR time 256 counts long",
+    "a frame ending at a Timer 1 tick or a zero cross, the order hangs on a cycle",
+    "a switch step due at the zero cross of a timer blink, the order hangs on the main loop",
+    "a gap of 16 ms or more with bit 11 clear, 0.7 takes it for a pulse",
+    "a bit time of 256 counts or more, 0.7 checks its LSB alone"};
+
+enum {PROTO_NEC, PROTO_SAMSUNG, PROTO_RC5, PROTO_SIRC, PROTO_COUNT};
+static const char *ProtoName[PROTO_COUNT] = {"nec", "samsung", "rc5", "sirc"};
+static int Protocol;                                    // Of the key presses
+static const char *PulseName[PULSE_IDLE + 1] = {"noise", "560", "890", "1200", "1690", "2000", "2250", "4500",
+                                                 "9000", "11250", "13500", "idle"};
+static unsigned short DecodePrev;                       // IRTime of the last decoded edge
+static uint64_t DecodeEdges, DecodeCycles, OldCycles, ClassEdges[PULSE_IDLE + 1], ClassCycles[PULSE_IDLE + 1];
+static unsigned DecodeMax, OldMax;
+
+// F U N C T I O N S
+static void Advance(uint64_t Ns);
+
+static int NearLimit(unsigned Interval)
+{
+    unsigned i;
+
+    if((Interval + STEADY_MARGIN) % 0x0800 <= 2 * STEADY_MARGIN)
+        return 1;                                       // Bit 11, the idle test of the 0.7 decoder
+    for(i = 0; i < sizeof(IrLimits) / sizeof(IrLimits[0]); i++)
+    {
+        if(abs((int)Interval - (int)IrLimits[i]) <= STEADY_MARGIN ||
+           abs((int)(Interval & 0xFF) - (int)IrLimits[i]) <= STEADY_MARGIN)
+            return 1;
+    }
+    return 0;
+}
+
+static void AddHazard(uint64_t Time, int Kind)
+{
+    if(HazardCount == HazardSize)
+    {
+        HazardSize = HazardSize ? HazardSize * 2 : 256;
+        Hazards = realloc(Hazards, HazardSize * sizeof(HAZARD));
+    }
+    Hazards[HazardCount].Time = Time;
+    Hazards[HazardCount].Kind = Kind;
+    HazardCount++;
+}
+/**
+Move an IR edge of a scenario off the points where the outcome hangs on a single cycle,
+as the host model has no cycle exact interrupt latency: an interval (or its low byte) at a
+decoder limit, and TMR1L rolling over between the TMR1L and TMR1H reads of 0.7. An edge at
+a zero cross is captured up to ZC_BUSY_NS late, its intervals are kept clear of the limits
+over that span
+*/
+static uint64_t SteadyEdge(uint64_t t)
+{
+    uint64_t Roll = T1_OVERFLOW / 65536, Phase;        // Cycles of a Timer 1 count
+    uint64_t Tick = SEC_NS / IR_CLOCK, Late, Interval;
+
+    if(t < LastIrEdge + STEADY_GAP_NS)
+        t = LastIrEdge + STEADY_GAP_NS;
+    for(;;)
+    {
+        Phase = (t / TCY_NS + READ_MIN_CYCLES + 256 * Roll - T1_START_CYCLES) % (256 * Roll);
+        Late = (t + ZC_BUSY_BEFORE_NS) % HalfPeriod < ZC_BUSY_BEFORE_NS + ZC_BUSY_NS ? ZC_BUSY_NS : 0;
+        if(Phase >= 256 * Roll - (READ_MAX_CYCLES + Late / TCY_NS - READ_MIN_CYCLES))
+        {
+            t += (256 * Roll - Phase + Roll) * TCY_NS;
+            continue;
+        }
+        Interval = t - LastIrEdge > LastIrLate ? t - LastIrEdge - LastIrLate : 0;
+        for(; Interval <= t + Late - LastIrEdge; Interval += Tick)
+        {
+            if(NearLimit((unsigned)(Interval / Tick) & 0xFFFF))
+                break;
+        }
+        if(Interval <= t + Late - LastIrEdge)
+            t += Tick;
+        else
+        {
+            LastIrLate = Late;
+            return LastIrEdge = t;
+        }
+    }
+}
+
+static void AddEvent(uint64_t Time, unsigned char Mask, unsigned char Level)
+{
+    if(Steady && Mask == IR_PIN_MASK && SteadyEdge(Time) != Time)
+    {
+        Time = LastIrEdge;
+        Steered[0]++;
+    }
+    if(EventCount == EventSize)
+    {
+        EventSize = EventSize ? EventSize * 2 : 4096;
+        Events = realloc(Events, EventSize * sizeof(PIN_EVENT));
+    }
+    Events[EventCount].Time = Time;
+    Events[EventCount].Mask = Mask;
+    Events[EventCount].Level = Level;
+    EventCount++;
+}
+
+static int CompareEvents(const void *a, const void *b)
+{
+    const PIN_EVENT *x = a, *y = b;
+    return (x->Time > y->Time) - (x->Time < y->Time);
+}
+static void AddNote(uint64_t Time, const char *Format, ...)
+{
+    va_list Args;
+
+    if(NoteCount == NoteSize)
+    {
+        NoteSize = NoteSize ? NoteSize * 2 : 256;
+        Notes = realloc(Notes, NoteSize * sizeof(NOTE));
+    }
+    Notes[NoteCount].Time = Time;
+    va_start(Args, Format);
+    vsnprintf(Notes[NoteCount].Text, sizeof(Notes[NoteCount].Text), Format, Args);
+    va_end(Args);
+    NoteCount++;
+}
+/**
+Put a frame on the IR pin, the edges from its start; the first one starts a mark (the
+sensor output low)
+*/
+static uint64_t PlayEdges(uint64_t t, const uint64_t *Edges, int n)
+{
+    int i;
+
+    for(i = 0; i < n; i++)
+        AddEvent(t + Edges[i], IR_PIN_MASK, i & 1);
+    Frames++;
+    return t + Edges[n - 1];
+}
+/**
+The edges of a NEC frame (or a repeat) from its start, the first one starts a mark;
+returns their number
+*/
+static int NECEdges(uint64_t *Edges, unsigned char Address, unsigned char Cmd, int Repeat)
+{
+    unsigned long Data = (unsigned long)(~Cmd & 0xFF) << 24 | (unsigned long)Cmd << 16 |
+                         (unsigned long)(~Address & 0xFF) << 8 | Address;
+    int i, n = 0;
+
+    Edges[n++] = 0;                                     // Header mark and space
+    Edges[n++] = 9000000;
+    Edges[n++] = Repeat ? 11250000 : 13500000;
+    for(i = 0; i < (Repeat ? 0 : 32); i++, Data >>= 1)
+    {
+        Edges[n] = Edges[n - 1] + 560000;
+        n++;
+        Edges[n] = Edges[n - 1] + ((Data & 1) ? 1690000 : 560000);
+        n++;
+    }
+    Edges[n] = Edges[n - 1] + 560000;                   // Stop bit
+    n++;
+    return n;
+}
+/**
+Whether the end of a frame at t and a Timer 1 tick or a zero cross may come in either
+order; Step is how far on the frame may be clear
+*/
+static int FrameHazard(uint64_t t, const uint64_t *Edges, int n, uint64_t *Step)
+{
+    uint64_t End, Tick = (uint64_t)T1_OVERFLOW * TCY_NS;
+
+    End = (t + Edges[n - 1] + Tick - T1_START_CYCLES * TCY_NS + TICK_BEFORE_NS) % Tick;
+    if(End < TICK_BEFORE_NS + TICK_AFTER_NS)            // The command and a Timer 1 tick in the same pass
+    {                                                   // of the main loop, the order hangs on a cycle
+        *Step = TICK_BEFORE_NS + TICK_AFTER_NS - End;
+        return 1;
+    }
+    End = (t + Edges[n - 2] + HalfPeriod - ZC_CLEAR_NS) % HalfPeriod;
+    if(End + Edges[n - 1] - Edges[n - 2] + 2 * ZC_CLEAR_NS > HalfPeriod)
+    {                                                   // Or a zero cross, Ticks and the LED timeout
+        *Step = HalfPeriod - End;
+        return 1;
+    }
+    return 0;
+}
+/**
+Put the edges of a NEC frame on the IR pin; a scenario moves it off the hazards of
+FrameHazard(), and on until SteadyEdge() nudges no interval out of its class
+*/
+static uint64_t NECPlay(uint64_t t, const uint64_t *Edges, int n)
+{
+    uint64_t Step, Nudge, LastNudge = 0, SavedEdge, SavedLate, Planned = t;
+    int i;
+
+    while(Steady)
+    {
+        if(FrameHazard(t, Edges, n, &Step))
+        {
+            t += Step;
+            continue;
+        }
+        SavedEdge = LastIrEdge;                         // A dry run of SteadyEdge(), the frame moves on
+        SavedLate = LastIrLate;                         // until no interval is nudged out of its class
+        for(i = 0; i < n; i++)
+        {
+            Nudge = SteadyEdge(t + Edges[i]) - (t + Edges[i]);
+            if(i && (Nudge > LastNudge + STEADY_SKEW_NS || LastNudge > Nudge + STEADY_SKEW_NS))
+                break;
+            LastNudge = Nudge;
+        }
+        LastIrEdge = SavedEdge;
+        LastIrLate = SavedLate;
+        if(i == n)
+            break;
+        t += STEADY_STEP_NS;
+    }
+    if(t != Planned)
+        Steered[1]++;
+    if(Lockstep && !Steady && FrameHazard(t, Edges, n, &Step))
+        AddHazard(t + Edges[n - 1], HAZARD_ORDER);
+    return PlayEdges(t, Edges, n);
+}
+/**
+A NEC frame (or a repeat) on the IR pin, the sensor output is low for a mark
+*/
+static uint64_t NECFrame(uint64_t t, unsigned char Address, unsigned char Cmd, int Repeat)
+{
+    uint64_t Edges[NEC_EDGES];
+
+    return NECPlay(t, Edges, NECEdges(Edges, Address, Cmd, Repeat));
+}
+#if defined IR_SAMSUNG
+/**
+A Samsung frame: a 4.5 ms header mark, the address twice and the command with its complement
+*/
+static uint64_t SamsungFrame(uint64_t t, unsigned char Address, unsigned char Cmd)
+{
+    unsigned long Data = (unsigned long)(~Cmd & 0xFF) << 24 | (unsigned long)Cmd << 16 |
+                         (unsigned long)Address << 8 | Address;
+    uint64_t Edges[2 * 34];
+    int i, n = 0;
+
+    Edges[n++] = 0;
+    Edges[n++] = 4500000;
+    Edges[n++] = 9000000;
+    for(i = 0; i < 32; i++, Data >>= 1)
+    {
+        Edges[n] = Edges[n - 1] + 560000;
+        n++;
+        Edges[n] = Edges[n - 1] + ((Data & 1) ? 1690000 : 560000);
+        n++;
+    }
+    Edges[n] = Edges[n - 1] + 560000;                   // Stop bit
+    n++;
+    return PlayEdges(t, Edges, n);
+}
+#endif
+#if defined IR_RC5
+/**
+A RC5 frame, 14 bits Manchester coded with a 889us half bit, a one is a space then a mark.
+The first edge is the mark in the middle of the first start bit
+*/
+static uint64_t RC5Frame(uint64_t t, unsigned char Address, unsigned char Cmd, int Toggle)
+{
+    unsigned Data = 0x3000 | (Toggle ? 0x0800 : 0) | (Address & 0x1F) << 6 | (Cmd & 0x3F);
+    uint64_t Edges[28];
+    int i, Mark, Level = 0, n = 0;
+
+    for(i = 0; i < 28; i++)                             // Half bits, from the MSB
+    {
+        Mark = ((Data >> (13 - i / 2)) & 1) == (i & 1);
+        if(Mark != Level)
+            Edges[n++] = (i - 1) * 889000ULL;
+        Level = Mark;
+    }
+    if(Level)
+        Edges[n++] = 27 * 889000ULL;
+    return PlayEdges(t, Edges, n);
+}
+#endif
+#if defined IR_SIRC
+/**
+A SIRC 12 bit frame: a 2.4 ms header mark, then LSB first a 600us space and a 1200us (one)
+or 600us (zero) mark, 7 command and 5 address bits
+*/
+static uint64_t SIRCFrame(uint64_t t, unsigned char Address, unsigned char Cmd)
+{
+    unsigned Data = (Cmd & 0x7F) | (Address & 0x1F) << 7;
+    uint64_t Edges[2 + 24];
+    int i, n = 0;
+
+    Edges[n++] = 0;
+    Edges[n++] = 2400000;
+    for(i = 0; i < 12; i++, Data >>= 1)
+    {
+        Edges[n] = Edges[n - 1] + 600000;
+        n++;
+        Edges[n] = Edges[n - 1] + ((Data & 1) ? 1200000 : 600000);
+        n++;
+    }
+    return PlayEdges(t, Edges, n);
+}
+#endif
+#if defined IR_SAMSUNG || defined IR_RC5 || defined IR_SIRC
+/**
+Code of a NEC command on another remote, from the map of the firmware
+*/
+static unsigned char NativeCmd(const unsigned char *Map, unsigned char Cmd)
+{
+    for(; *Map != NO_CMD; Map += 2)
+    {
+        if(Map[1] == Cmd)
+            return Map[0];
+    }
+    return Cmd;
+}
+#endif
+/**
+The decoder of the protocol is in this build
+*/
+static int ProtoBuilt(int p)
+{
+    switch(p)
+    {
+        case PROTO_NEC: return 1;
+#if defined IR_SAMSUNG
+        case PROTO_SAMSUNG: return 1;
+#endif
+#if defined IR_RC5
+        case PROTO_RC5: return 1;
+#endif
+#if defined IR_SIRC
+        case PROTO_SIRC: return 1;
+#endif
+    }
+    return 0;
+}
+/**
+A key press on the remote of the protocol, the frame and 4 repeats as a held key sends them
+*/
+static void KeyPress(uint64_t t, unsigned char Cmd, unsigned Press)
+{
+    uint64_t f;
+    int r;
+
+    (void)Press;                                        // The RC5 toggle bit only
+    switch(Protocol)
+    {
+        case PROTO_NEC:
+        f = NECFrame(t, 0x00, Cmd, 0);
+        for(r = 0; r < 4; r++)
+            NECFrame(f + (r + 1) * 108 * MS_NS - 67500000, 0x00, Cmd, 1);
+        break;
+#if defined IR_SAMSUNG
+        case PROTO_SAMSUNG:
+        for(r = 0; r < 5; r++)
+            SamsungFrame(t + r * 108 * MS_NS, SAMSUNG_ADDRESS, NativeCmd(SamsungMap, Cmd));
+        break;
+#endif
+#if defined IR_RC5
+        case PROTO_RC5:
+        for(r = 0; r < 5; r++)
+            RC5Frame(t + r * 114 * MS_NS, RC5_ADDRESS, NativeCmd(RC5Map, Cmd), Press & 1);
+        break;
+#endif
+#if defined IR_SIRC
+        case PROTO_SIRC:
+        for(r = 0; r < 5; r++)
+            SIRCFrame(t + r * 45 * MS_NS, SIRC_ADDRESS, NativeCmd(SIRCMap, Cmd));
+        break;
+#endif
+    }
+}
+
+static int LoadEdges(const char *Name, uint64_t Offset)
+{
+    FILE *f = fopen(Name, "r");
+    char Line[128];
+    unsigned long long t;
+    unsigned Level;
+
+    if(f == NULL)
+    {
+        perror(Name);
+        return -1;
+    }
+    while(fgets(Line, sizeof(Line), f))
+    {
+        if(sscanf(Line, "%llu %u", &t, &Level) == 2)
+            AddEvent(Offset + t, IR_PIN_MASK, Level ? 1 : 0);
+    }
+    fclose(f);
+    return 0;
+}
+/**
+Prescaler of TMR0 and Timer 1 in instruction cycles
+*/
+static uint64_t Tmr0Tick(void)
+{
+    return (OPTION & 0x08) ? 1 : 2 << (OPTION & 0x07);
+}
+
+static uint64_t Tmr1Tick(void)
+{
+    return 1 << ((T1CON >> 4) & 0x03);
+}
+/**
+Take in a TMR0 load from the firmware, TMR0 is inhibited for two cycles after a write
+*/
+static void UpdateTmr0(void)
+{
+    if(Tmr0Written)
+    {
+        Tmr0Written = 0;
+        Tmr0Base = Tmr0WriteTime + 2 * TCY_NS;
+        NextT0 = Tmr0Base + (256 - Tmr0Reg) * Tmr0Tick() * TCY_NS;
+    }
+}
+/**
+Watch the TRIAC gate, a firing is the gate going on
+*/
+static void SampleOutputs(void)
+{
+    int On = (TRIAC == 0);
+
+    if(On && !Gate && !Fired)
+    {
+        Fired = 1;
+        FireTime = Now;
+    }
+    if(!On && Gate && Fired && FireTime == LastZc && Now - LastZc < HOLD_NS)
+        Fired = 0;                                      // Held over the zero cross, the current too low to latch
+    Gate = On;
+}
+/**
+Load of the speed of the half cycle just over: interrupts, power, gaps and the power
+averaged over FLICKER_NS
+*/
+static void SpeedHalfOver(double Power)
+{
+    SPEED_LOAD *p = &Load[HalfSpeed];
+    unsigned Halves = (unsigned)((FLICKER_NS + HalfPeriod / 2) / HalfPeriod);
+    double Average;
+
+    if(HalfSpeed != LoadSpeed)                          // A new run of the speed
+    {
+        LoadSpeed = HalfSpeed;
+        p->Gap = p->WinHalves = 0;
+        p->Window = 0.0;
+    }
+    if(HalfSpeed == 0 || LastZc == 0)
+        return;
+    p->Halves++;
+    p->Isrs += IsrCount - HalfIsr;
+    p->T0s += T0Isr - HalfT0;
+    p->Power += Power;
+    p->Burst = HalfBurst;
+    p->Gap = Power > 0.0 ? 0 : p->Gap + 1;
+    if(p->Gap > p->MaxGap)
+        p->MaxGap = p->Gap;
+    p->Window += Power;
+    if(++p->WinHalves < Halves)
+        return;
+    Average = p->Window / p->WinHalves;
+    if(p->Windows == 0 || Average < p->WinMin)
+        p->WinMin = Average;
+    if(p->Windows == 0 || Average > p->WinMax)
+        p->WinMax = Average;
+    p->Windows++;
+    p->WinHalves = 0;
+    p->Window = 0.0;
+}
+/**
+Firing of the half cycle just over, grouped by the phase angle it started with; the
+burst fired ones only count for the speed
+*/
+static void HalfCycleOver(void)
+{
+    FIRING *p = &Firing[HalfAngle];
+    double Delay, Angle;
+
+    Delay = Fired && LastZc ? (FireTime - LastZc) / 1000.0 : 0.0;
+    Angle = fmin(M_PI, M_PI * Delay * 1000.0 / HalfPeriod);
+    SpeedHalfOver(Fired ? 1.0 - Angle / M_PI + sin(2.0 * Angle) / (2.0 * M_PI) : 0.0);
+    if(!Fired || LastZc == 0 || HalfBurst)
+        return;
+    if(p->Count == 0 || Delay < p->Min)
+        p->Min = Delay;
+    if(p->Count == 0 || Delay > p->Max)
+        p->Max = Delay;
+    p->Count++;
+    p->Sum += Delay;
+    p->SumSq += Delay * Delay;
+}
+/**
+Drive an input pin, with the interrupt on change and INT flags
+*/
+static void SetPin(unsigned char Mask, unsigned char Level)
+{
+    unsigned char Old = Pins;
+
+    Pins = Level ? (Pins | Mask) : (Pins & ~Mask);
+    if(Old == Pins)
+        return;
+    if(IOC & Mask)
+    {
+        GPIF = 1;
+        ZcChanged |= (Mask == ZC_PIN_MASK);
+        IrChanged |= (Mask == IR_PIN_MASK);
+    }
+    if(Mask == 0x04 && ((OPTION & 0x40) ? Level : !Level))
+        INTF = 1;                                       // INT pin edge
+    if(Mask == IR_PIN_MASK)
+        IrEdges++;
+}
+
+static void SyncInputs(void)
+{
+    GPIO = (GPIO & ~TRISIO) | (Pins & TRISIO);
+}
+
+// -- Lockstep --
+/**
+Which side of each decoder limit an interval is on, and of those of its low byte, bit 11
+and the high byte, the tests 0.7 makes
+*/
+static unsigned long LimitSides(unsigned Interval)
+{
+    unsigned long Sides = (Interval & 0x0800) ? 1 : 0;
+    unsigned i;
+
+    Sides |= Interval >= 0x100 ? 2 : 0;
+    for(i = 0; i < sizeof(IrLimits) / sizeof(IrLimits[0]); i++)
+    {
+        Sides |= (unsigned long)(Interval > IrLimits[i]) << (2 + 2 * i);
+        Sides |= (unsigned long)((Interval & 0xFF) > IrLimits[i]) << (3 + 2 * i);
+    }
+    return Sides;
+}
+/**
+An edge the HEX decoded with the bit time Interval: with the host decode of the same edge,
+the nearest IRTime, on another side of a limit it is a HAZARD_LIMIT, the two captures of
+the edge a cycle or a zero cross apart. A first edge of a frame on the host is left to
+DecoderHazard()
+*/
+static void PairEdge(uint64_t Time, unsigned short Snapshot, unsigned short Interval)
+{
+    HOST_EDGE *e, *Best = NULL;
+    unsigned i, Near = PAIR_COUNTS + 1, d;
+
+    for(i = 0; i < HOST_EDGES && i < HostEdge; i++)
+    {
+        e = &HostEdges[i];
+        d = (unsigned)abs((short)(e->Snapshot - Snapshot));
+        if(d < Near && e->Time + PAIR_NS >= Time && e->Time <= Time + PAIR_NS)
+        {
+            Near = d;
+            Best = e;
+        }
+    }
+    if(Best != NULL && !Best->Idle && LimitSides(Interval) != LimitSides(Best->Interval))
+        AddHazard(Time, HAZARD_LIMIT);
+}
+/**
+Run the HEX on the emulator up to a time, with the same zero cross and pin events as
+the host model, watching its TRIAC gate the same way, and its IR decoder: each decoded
+edge, once PrevIRTimer is stored (its bit time before it), with an IRTime ahead of Timer 1,
+TMR1L rolled over between its reads (HAZARD_RACE), or else for PairEdge()
+*/
+static void HexRun(uint64_t Until)
+{
+    static unsigned short Prev;
+    unsigned short Snapshot, Stored, Ahead;
+    uint64_t t;
+    int On;
+
+    while((t = Hex.Cycles * Hex.TcyNs) < Until)
+    {
+        if(HexZc <= t)
+        {
+            HexLastZc = HexZc;
+            HexFired = HexGate;                         // Held from the last half, not a new firing
+            if(HexGate)
+                HexFireTime = HexZc;
+            Pic14SetPin(&Hex, ZC_PIN_MASK, !(Hex.Pins & ZC_PIN_MASK));
+            HexZc += HalfPeriod;
+        }
+        while(HexEvent < EventCount && Events[HexEvent].Time <= t)
+        {
+            Pic14SetPin(&Hex, Events[HexEvent].Mask, Events[HexEvent].Level);
+            HexEvent++;
+        }
+        Pic14Step(&Hex);
+        On = !(Hex.Ram[PIC14_TRISIO] & 0x20) && !(Pic14Port(&Hex) & 0x20);
+        if(On && !HexGate && !HexFired)
+        {
+            HexFired = 1;
+            HexFireTime = Hex.Cycles * Hex.TcyNs;
+        }
+        HexGate = On;
+        Snapshot = Hex.Ram[HEX_IR_TIME + 1] << 8 | Hex.Ram[HEX_IR_TIME];
+        Stored = Hex.Ram[HEX_PREV_IR_TIMER + 1] << 8 | Hex.Ram[HEX_PREV_IR_TIMER];
+        if(Stored != Prev && Stored == Snapshot)
+        {
+            Prev = Stored;
+            Ahead = Snapshot - (Hex.Ram[PIC14_TMR1H] << 8 | Hex.Ram[PIC14_TMR1L]);
+            if(Ahead != 0 && Ahead <= 256)
+                AddHazard(t, HAZARD_RACE);
+            else
+                PairEdge(t, Snapshot, Hex.Ram[HEX_IR_BIT_TIME + 1] << 8 | Hex.Ram[HEX_IR_BIT_TIME]);
+        }
+    }
+}
+
+static void PrintSnapshot(const SNAPSHOT *s, unsigned Diff)
+{
+    unsigned i;
+
+    if(s->Fired)
+        printf("%c%6u", (Diff & DIFF_TRIAC) ? '*' : ' ', s->Delay);
+    else
+        printf("%c     -", (Diff & DIFF_TRIAC) ? '*' : ' ');
+    printf(" %c%u %c%u %c%u %c%02X %c%02X %c", (Diff & DIFF_LED) ? '*' : ' ', s->Led, (Diff & DIFF_SPEED) ? '*' : ' ', s->Speed,
+           (Diff & DIFF_TIME) ? '*' : ' ', s->Hours, (Diff & DIFF_STATUS) ? '*' : ' ', s->Status,
+           (Diff & DIFF_BLINK) ? '*' : ' ', s->Blink, (Diff & DIFF_EEPROM) ? '*' : ' ');
+    for(i = 0; i < LOCKSTEP_EE; i++)
+        printf("%02X", s->EE[i]);
+}
+/**
+The first lasting difference, with the half cycles and the stimuli before it, and the
+hazard it is put down to: the last one in the EXPLAIN_NS before it, EXPLAIN_LED_NS for the
+LED, that shows a command or a repeat up to a timer blink (640 ms) after the frame, and
+EXPLAIN_ORDER half cycles for an order, that takes effect at once. Without one it fails
+*/
+static void ReportDivergence(unsigned Field)
+{
+    uint64_t First = Halves + 1 - DiffRun[Field], From, i, Time = Trace[First % TRACE_SIZE].Time, At = 0, Span;
+    size_t n;
+
+    printf("Divergence       : %s, from %.3f s (half cycle %llu)", DiffName[Field],
+           Time / (double)SEC_NS, (unsigned long long)First);
+    if(ScenarioSeed)
+        printf(", scenario %llu", (unsigned long long)ScenarioSeed);
+    printf("\n");
+    for(n = 0; n < HazardCount; n++)
+    {
+        if(Hazards[n].Kind == HAZARD_ORDER || Hazards[n].Kind == HAZARD_STEP)
+            Span = (EXPLAIN_ORDER + 1) * HalfPeriod;
+        else
+            Span = (1u << Field) == DIFF_LED ? EXPLAIN_LED_NS : EXPLAIN_NS;
+        if(Hazards[n].Time <= Time && Hazards[n].Time + Span >= Time && Hazards[n].Time >= At)
+        {
+            Cause = Hazards[n].Kind;
+            At = Hazards[n].Time;
+        }
+    }
+    if(Cause >= 0)
+        printf("Explained        : %s at %.3f s, %s\n", HazardName[Cause], At / (double)SEC_NS, HazardText[Cause]);
+    else
+        printf("Explained        : no, FAILED\n");
+    From = Halves + 1 > Window ? Halves + 1 - Window : 0;
+    if(From > First)
+        From = First;
+    if(Halves - From >= TRACE_SIZE)
+        From = Halves + 1 - TRACE_SIZE;
+    printf("Trace            :     time(s)   host fire LED Spd Tim Sts Blk EEPROM       HEX fire LED Spd Tim Sts Blk EEPROM\n");
+    for(i = From; i <= Halves; i++)
+    {
+        HALF_TRACE *h = &Trace[i % TRACE_SIZE];
+        printf("                   %10.3f  ", h->Time / (double)SEC_NS);
+        PrintSnapshot(&h->Host, h->Diff);
+        printf("  ");
+        PrintSnapshot(&h->Hex, h->Diff);
+        printf("\n");
+    }
+    for(n = 0; n < NoteCount; n++)
+    {
+        if(Notes[n].Time + HalfPeriod >= Trace[From % TRACE_SIZE].Time && Notes[n].Time <= Now)
+            printf("Stimulus         : %10.3f  %s\n", Notes[n].Time / (double)SEC_NS, Notes[n].Text);
+    }
+}
+/**
+At a zero cross: bring the HEX to the same time and compare the half cycle just over
+*/
+static void LockstepHalfCycle(void)
+{
+    HALF_TRACE *h = &Trace[Halves % TRACE_SIZE];
+    SNAPSHOT *a = &h->Host, *b = &h->Hex;
+    unsigned i, Diff = 0;
+
+    HexRun(Now);
+    if(KeyCount == 3 && (Key & 0x80) && Ticks == 0x3F && TimerRunning && !ClearLED)
+        AddHazard(Now, HAZARD_STEP);                    // The isr of this zero cross makes both due
+    h->Time = Now;
+    a->Fired = Fired;
+    a->Delay = Fired ? (unsigned)((FireTime - LastZc) / 1000) : 0;
+    a->Led = GPIO1;
+    a->Speed = Speed;
+    a->Hours = Time;
+    a->Status = Status._byte;
+    a->Blink = Count;
+    memcpy(a->EE, EEData, PIC14_EE_SIZE);
+    b->Fired = HexFired;
+    b->Delay = HexFired ? (unsigned)((HexFireTime - HexLastZc) / 1000) : 0;
+    b->Led = (Pic14Port(&Hex) >> 1) & 0x01;
+    b->Speed = Hex.Ram[HEX_SPEED];
+    b->Hours = Hex.Ram[HEX_TIME];
+    b->Status = Hex.Ram[HEX_STATUS];
+    b->Blink = Hex.Ram[HEX_COUNT];
+    memcpy(b->EE, Hex.EE, PIC14_EE_SIZE);
+
+    if(a->Fired != b->Fired || (a->Fired && abs((int)a->Delay - (int)b->Delay) > FIRE_SLACK_US))
+        Diff |= DIFF_TRIAC;
+    if(a->Led != b->Led)
+        Diff |= DIFF_LED;
+    if(a->Speed != b->Speed)
+        Diff |= DIFF_SPEED;
+    if(a->Hours != b->Hours)
+        Diff |= DIFF_TIME;
+    if(a->Status != b->Status)
+        Diff |= DIFF_STATUS;
+    if(a->Blink != b->Blink)
+        Diff |= DIFF_BLINK;
+    for(i = 0; i < PIC14_EE_SIZE; i++)
+    {
+#if defined USAGE_COUNTERS
+        if(i == EE_RUN_MINUTES)                         // Not the usage counters, 0.7 has none
+            i = EE_USAGE_VERSION + 1;
+#endif
+        if(a->EE[i] != b->EE[i])
+            Diff |= DIFF_EEPROM;
+    }
+    h->Diff = Diff;
+    for(i = 0; i < DIFF_FIELDS; i++)
+    {
+        DiffRun[i] = (Diff & (1 << i)) ? DiffRun[i] + 1 : 0;
+        if(DiffRun[i] > LOCKSTEP_SLACK)
+        {
+            Diverged = 1;
+            ReportDivergence(i);
+            longjmp(Stop, 1);
+        }
+    }
+    Halves++;
+}
+
+static uint64_t NextEvent(void)
+{
+    uint64_t Next = NextZc;
+
+    if(EventNext < EventCount && Events[EventNext].Time < Next)
+        Next = Events[EventNext].Time;
+    if(NextT0 && NextT0 < Next)
+        Next = NextT0;
+    if((T1CON & 0x01) && NextTmr1 < Next)
+        Next = NextTmr1;
+    return Next;
+}
+
+static void ApplyEvents(void)
+{
+    if(NextZc == Now)
+    {
+        if(Lockstep)
+            LockstepHalfCycle();
+        HalfCycleOver();
+        LastZc = Now;
+        HalfAngle = PhaseAngle;
+        HalfSpeed = FanOn && PhaseAngle == STable[Speed] ? Speed : 0;
+#if defined BURST_FIRE
+        HalfBurst = BurstDensity != 0;
+#endif
+        HalfIsr = IsrCount;
+        HalfT0 = T0Isr;
+        Fired = Gate;                                   // Held from the last half, not a new firing
+        if(Gate)
+            FireTime = Now;
+        SetPin(ZC_PIN_MASK, !(Pins & ZC_PIN_MASK));
+        NextZc += HalfPeriod;
+    }
+    while(EventNext < EventCount && Events[EventNext].Time == Now)
+    {
+        SetPin(Events[EventNext].Mask, Events[EventNext].Level);
+        EventNext++;
+    }
+    if(NextT0 == Now)
+    {
+        T0IF = 1;
+        NextT0 = Now + 256 * Tmr0Tick() * TCY_NS;
+    }
+    if(NextTmr1 == Now)
+    {
+        TMR1IF = 1;
+        NextTmr1 = Now + 65536 * Tmr1Tick() * TCY_NS;
+    }
+    SyncInputs();
+}
+
+static int InterruptPending(void)
+{
+    return GIE && ((T0IE && T0IF) || (INTE && INTF) || (GPIE && GPIF) || (PEIE && (PIE1 & 0x01) && TMR1IF));
+}
+/**
+Run isr() and charge its time; again while another interrupt is pending at RETFIE
+*/
+static void RunIsr(void)
+{
+    int Zc, Ir, Gpif, Int, T0, Tmr1, Missed;
+    unsigned char Seen;
+
+    do
+    {
+        InIsr = 1;
+        IsrCount++;
+        Advance(ISR_ENTRY_CYCLES * TCY_NS);
+        Gpif = GPIF;
+        Zc = Gpif && ZcChanged;
+        Ir = Gpif && IrChanged;
+        if(Gpif)
+        {
+            ZcChanged = IrChanged = 0;
+            Advance((GPIF_CYCLES + (Zc ? ZC_PRE_CYCLES : 0) + (Ir ? IR_PRE_CYCLES : 0)) * TCY_NS);
+        }
+        else
+            Advance(TEST_CYCLES * TCY_NS);
+        Int = INTF;
+        T0 = T0IF;
+        Tmr1 = TMR1IF;
+        NopCount = 0;
+        SyncInputs();
+        Seen = Pins;
+        Missed = !Gpif && GPIF;                         // Set after the test, served on the next pass
+        if(Missed)
+            GPIF = 0;
+        isr();
+        if(Missed)
+            GPIF = 1;
+        if((Pins ^ Seen) & IOC)                         // Changed after the port read, the mismatch sets GPIF again
+            GPIF = 1;
+        UpdateTmr0();
+        SampleOutputs();
+        Int = Int && !INTF;                             // Served, if isr() cleared the flag
+        T0 = T0 && !T0IF;
+        Tmr1 = Tmr1 && !TMR1IF;
+        ZcIsr += Zc;
+        IrIsr += Ir || Int;
+        T0Isr += T0;
+        Tmr1Isr += Tmr1;
+        Advance(((Zc ? ZC_CYCLES : 0) + (Zc && FanOn ? ZC_FAN_CYCLES : 0) +
+                 (Ir ? IR_CYCLES : 0) + (Int ? IR_CYCLES : 0) +
+                 (T0 ? T0_CYCLES : TEST_CYCLES) + (Tmr1 ? TMR1_CYCLES : TEST_CYCLES) +
+                 ISR_EXIT_CYCLES) * TCY_NS);
+        InIsr = 0;
+    }while(InterruptPending());
+}
+/**
+Let the simulated time pass, with the events and interrupts on the way. Time spent in
+isr() does not count for the code that was interrupted
+*/
+static void Advance(uint64_t Ns)
+{
+    uint64_t End = Now + Ns, Left, Next;
+
+    UpdateTmr0();
+    for(;;)
+    {
+        Next = NextEvent();
+        if(Next > End)
+            break;
+        Now = Next;
+        ApplyEvents();
+        if(!InIsr && InterruptPending())
+        {
+            Left = End - Now;
+            RunIsr();
+            End = Now + Left;
+        }
+    }
+    Now = End;
+    if(!InIsr && Now >= StopTime)
+        longjmp(Stop, 1);
+}
+
+// -- pic.h hooks --
+volatile unsigned char *SimTMR0(void)
+{
+    Tmr0Written = 1;                                    // The firmware only writes TMR0
+    Tmr0WriteTime = Now;
+    return &Tmr0Reg;
+}
+
+volatile unsigned char *SimTMR1(unsigned char Byte)
+{
+    unsigned Count;
+
+    Count = (T1CON & 0x01) && Now > T1_START_CYCLES * TCY_NS ?
+            (unsigned)((Now / TCY_NS - T1_START_CYCLES) / Tmr1Tick()) & 0xFFFF : 0;
+    Tmr1Byte = Byte ? Count >> 8 : Count & 0xFF;
+    Advance(TMR1_READ_CYCLES * TCY_NS);                 // Timer 1 runs on to the next byte read
+    return &Tmr1Byte;
+}
+
+void _delay(unsigned long Cycles)
+{
+    SampleOutputs();
+    if(InIsr)
+        NopCount++;
+    Advance(Cycles * TCY_NS);
+}
+
+unsigned char eeprom_read(unsigned char Addr)
+{
+    if(EEBusy > Now)
+        Advance(EEBusy - Now);
+    Advance(EE_READ_CYCLES * TCY_NS);
+    return EEData[Addr & 0x7F];
+}
+
+unsigned char SimWR(void)
+{
+    return EEBusy > Now;
+}
+
+void eeprom_write(unsigned char Addr, unsigned char Value)
+{
+    if(EEBusy > Now)                                    // The previous write still in progress
+        Advance(EEBusy - Now);
+    Advance(EE_WRITE_CYCLES * TCY_NS);
+    EEBusy = Now + EE_BUSY_NS;
+    EEData[Addr & 0x7F] = Value;
+    EEWrites++;
+}
+
+void SimEEData(unsigned Block, const unsigned char *Data)
+{
+    if(Block < sizeof(EEData) / 8)
+        memcpy(&EEData[Block * 8], Data, 8);
+}
+
+// -- IR decode cost --
+/**
+Cycles of the pulse classifier of IRDecoder() for an interval, in the same order
+*/
+static unsigned ClassifyCycles(unsigned short t, IR_PULSE *Class)
+{
+    static const unsigned short Max[] = {MIN_IR_BIT_TIME - 1, PULSE_560_MAX, PULSE_890_MAX, PULSE_1200_MAX,
+                                         PULSE_1690_MAX, PULSE_2000_MAX};
+    unsigned c, i;
+
+#if PULSE_2000_MAX < 0x100
+    c = HIGH_TEST_CYCLES;
+    if(t < 0x100)
+    {
+        for(i = 0; i < 6 && (c += CMP8_CYCLES, t > Max[i]); i++)
+            ;
+#else
+    c = CMP16_CYCLES;
+    if(t <= PULSE_2000_MAX)
+    {
+        for(i = 0; i < 6 && (c += CMP16_CYCLES, t > Max[i]); i++)
+            ;
+#endif
+        *Class = (IR_PULSE)(PULSE_NOISE + i);           // Past the last, PULSE_2250
+        return c;
+    }
+    *Class = PULSE_IDLE;
+    if(c += IDLE_CYCLES, t >= IR_IDLE_TIME)
+        return c;
+#if defined IR_CAPTURE_INT
+    *Class = PULSE_13500;
+    if(c += CMP16_CYCLES, t > PULSE_11250_MAX)
+        return c;
+    *Class = PULSE_11250;
+    if(c += CMP16_CYCLES, t > PULSE_9000_MAX)
+        return c;
+#endif
+    *Class = PULSE_9000;
+    if(c += CMP16_CYCLES, t > PULSE_4500_MAX)
+        return c;
+    *Class = PULSE_4500;
+    if(c += CMP16_CYCLES, t > PULSE_2250_MAX)
+        return c;
+    *Class = PULSE_2250;
+    return c;
+}
+#if defined IR_NEC_ONLY
+/**
+Cycles of the NECDecoder() on the time itself, without the classes, for an interval in a state
+*/
+static unsigned NECCycles(unsigned short t, NEC_STATES State)
+{
+    unsigned c = 0;
+
+#if defined IR_CAPTURE_INT
+    if(c += IDLE_CYCLES, t >= IR_IDLE_TIME)
+        State = IR_IDLE;
+    switch(State)
+    {
+        case IR_MARK: c += (t <= PULSE_11250_MAX ? 2 : 1) * CMP16_CYCLES; break;
+        case IR_LOW:
+        c += CMP16_CYCLES;
+        if(t > PULSE_2000_MAX)
+            c += CMP16_CYCLES;
+        else
+            c += (IRShort(t) <= IRShort(PULSE_890_MAX) ? 1 : 2) * SHORT_CYCLES;
+        break;
+        default: break;
+    }
+#else
+#if PULSE_2000_MAX < 0x100
+    c += HIGH_TEST_CYCLES;
+    if(t >= 0x100)
+#endif
+    {
+        c += IDLE_CYCLES;
+        if(t >= IR_IDLE_TIME)
+            State = IR_IDLE;
+#if PULSE_2000_MAX < 0x100
+        else
+            c += CMP8_CYCLES;                           // The state test, then on with the LSB
+#endif
+    }
+    switch(State)
+    {
+        case IR_MARK: c += CMP16_CYCLES; break;
+        case IR_SPACE: c += (t <= PULSE_2250_MAX ? 2 : 1) * CMP16_CYCLES; break;
+        case IR_HIGH:
+        case IR_REPEAT: c += (IRShort(t) < IRShort(MIN_IR_BIT_TIME) ? 1 : 2) * SHORT_CYCLES; break;
+        case IR_LOW: c += 2 * SHORT_CYCLES; break;
+        default: break;
+    }
+#endif
+    return c;
+}
+#else
+/**
+Compares of NECDecoder() on a pulse class in a state
+*/
+static unsigned NECCompares(IR_PULSE Class, NEC_STATES State)
+{
+    unsigned n = 1;                                     // The PULSE_IDLE test
+
+    if(Class == PULSE_IDLE)
+        State = IR_IDLE;
+    switch(State)
+    {
+#if defined IR_CAPTURE_INT
+        case IR_MARK: n += (Class == PULSE_11250) ? 1 : 2; break;
+        case IR_LOW: n += (Class == PULSE_2250) ? 1 : 2; break;
+#else
+        case IR_MARK: n += 1; break;
+        case IR_SPACE: n += 2; break;
+        case IR_HIGH: n += 1; break;
+        case IR_LOW: n += 2; break;
+        case IR_REPEAT: n += 1; break;
+#endif
+        default: break;
+    }
+#if defined IR_SAMSUNG
+    n += (State == IR_MARK);                            // The Samsung header test
+#endif
+    return n;
+}
+#endif
+/**
+Cycles of the NECDecoder() of 0.7, on the time itself, for the same edge
+*/
+static unsigned OldNECCycles(unsigned short t, NEC_STATES State)
+{
+    unsigned char b = (unsigned char)t;
+    unsigned c = BIT_TEST_CYCLES;
+
+    if(t & 0x0800)
+        State = IR_IDLE;
+    switch(State)
+    {
+        case IR_MARK: c += CMP16_CYCLES; break;
+        case IR_SPACE: c += 2 * CMP16_CYCLES; break;
+        case IR_HIGH:
+        case IR_REPEAT: c += (b < (unsigned char)MIN_IR_BIT_TIME ? 1 : 2) * CMP8_CYCLES; break;
+        case IR_LOW: c += (b < (unsigned char)MIN_IR_BIT_TIME ? 2 : 3) * CMP8_CYCLES; break;
+        default: break;
+    }
+    return c;
+}
+/**
+An edge this decoder and the one of 0.7 take apart by design: a gap of 16 ms or more is
+idle here, where 0.7 tests its bit 11, and a bit time of 256 counts or more is an error,
+where 0.7 checks its LSB alone
+*/
+static void DecoderHazard(unsigned short t, NEC_STATES State)
+{
+    unsigned char b = (unsigned char)t;
+
+    if(State == IR_IDLE)
+        return;
+    if((t >= IR_IDLE_TIME) != ((t & 0x0800) != 0))
+        AddHazard(Now, HAZARD_IDLE);
+    else if(t >= 0x100 && !(t & 0x0800) && b >= (unsigned char)MIN_IR_BIT_TIME &&
+            (State == IR_LOW ? b <= (unsigned char)PULSE_2000_MAX :
+             (State == IR_HIGH || State == IR_REPEAT) && b <= (unsigned char)PULSE_560_MAX))
+        AddHazard(Now, HAZARD_BYTE);
+}
+/**
+Cost of the edge IRDecoder() takes next, with the same interval and state
+*/
+static void DecodeCost(void)
+{
+    unsigned short t = IRTime - DecodePrev;
+    HOST_EDGE *e;
+    IR_PULSE Class;
+    unsigned c, Old;
+
+    DecodePrev = IRTime;
+    c = ClassifyCycles(t, &Class);
+#if defined IR_NEC_ONLY
+    c = NECCycles(t, IRState);                          // The class for the report only
+#elif defined IR_NEC || defined IR_SAMSUNG
+    c += NECCompares(Class, IRState) * CMP8_CYCLES;
+#endif
+#if defined IR_RC5
+    c += (1 + RC5_CMPS) * CMP8_CYCLES;
+#endif
+#if defined IR_SIRC
+    c += (1 + SIRC_CMPS) * CMP8_CYCLES;
+#endif
+    DecodeEdges++;
+    DecodeCycles += c;
+    if(c > DecodeMax)
+        DecodeMax = c;
+    ClassEdges[Class]++;
+    ClassCycles[Class] += c;
+    Old = OldNECCycles(t, IRState);
+    OldCycles += Old;
+    if(Old > OldMax)
+        OldMax = Old;
+    if(Lockstep)
+    {
+        e = &HostEdges[HostEdge++ % HOST_EDGES];
+        e->Time = Now;
+        e->Snapshot = IRTime;
+        e->Interval = t;
+        e->Idle = IRState == IR_IDLE;
+        DecoderHazard(t, IRState);
+    }
+}
+
+void SimLoop(void)
+{
+    SampleOutputs();
+    Advance(LOOP_CYCLES * TCY_NS);
+    if(IRRx)                                            // IRDecoder() takes it now
+        DecodeCost();
+}
+
+/**
+Pseudo random numbers for the scenarios (xorshift), the same on every host
+*/
+static unsigned Random(unsigned n)
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 7;
+    Seed ^= Seed << 17;
+    return (unsigned)((Seed >> 11) % n);
+}
+/**
+An interval of a frame, steered twice STEADY_MARGIN from the decoder limits; moving the
+frame does not clear one that is at a limit itself
+*/
+static uint64_t ClearInterval(uint64_t Interval)
+{
+    uint64_t Tick = SEC_NS / IR_CLOCK;
+    unsigned i = 0;
+
+    while(Steady && i <= 4 * STEADY_MARGIN)
+    {
+        if(NearLimit((unsigned)(Interval / Tick + i - 2 * STEADY_MARGIN) & 0xFFFF))
+        {
+            Interval += Tick;
+            i = 0;
+        }
+        else
+            i++;
+    }
+    return Interval;
+}
+/**
+Jitter the edges of a frame as a remote does, within the classes: its clock off by Clock
+(per mille), the marks longer by Stretch (ns, the LED and the sensor) and each edge within
+20 us. Steered, the edges stay on the beat of the frame, SteadyEdge() moves them as much
+*/
+static void Jitter(uint64_t *Edges, int n, int Clock, int Stretch)
+{
+    uint64_t Prev = 0, Interval;
+    int i;
+
+    for(i = 1; i < n; i++)
+    {
+        Interval = Edges[i] - Prev;
+        Prev = Edges[i];
+        Interval += (int64_t)Interval * Clock / 1000 + ((i & 1) ? Stretch : -Stretch);
+        Edges[i] = Edges[i - 1] + ClearInterval(Interval);
+    }
+    for(i = 1; !Steady && i < n; i++)
+        Edges[i] += ((int)Random(41) - 20) * 1000;
+}
+/**
+Set the interval of a frame that ends at edge i, the later edges move with it
+*/
+static void SetInterval(uint64_t *Edges, int n, int i, uint64_t Interval)
+{
+    uint64_t Shift = Edges[i - 1] + ClearInterval(Interval) - Edges[i];
+
+    for(; i < n; i++)
+        Edges[i] += Shift;
+}
+/**
+A randomized scenario: the mains within 1% of 50 Hz, the settings in the EEPROM, then at
+random gaps remote keys with repeats, as sent and jittered, frames for other addresses,
+malformed and cut frames, IR noise and the switches
+*/
+static double Scenario(uint64_t Number)
+{
+    static const unsigned char Commands[] = {VOL_PLUS, VOL_MINUS, DIGIT0, DIGIT1, DIGIT2, DIGIT3, DIGIT4,
+        DIGIT5, DIGIT6, DIGIT7, DIGIT8, DIGIT9, CH_MINUS, CH_PLUS, PREV, NEXT, EQ, PLAY, DIGIT100PLUS};
+    uint64_t t, Start, Edges[NEC_EDGES], Interval;
+    unsigned char Cmd, Mask;
+    unsigned i, n;
+    int k, Clock, Stretch;
+    double Hz;
+
+    Seed = Number * 0x9E3779B97F4A7C15ULL + 1;
+    Steady = !Unsteered;
+    Hz = 49.5 + Random(1001) / 1000.0;
+    HalfPeriod = (uint64_t)(SEC_NS / (2.0 * Hz));       // For the zero crosses in SteadyEdge()
+    EEData[0] = Random(12);                             // Out of range ones too
+    EEData[1] = Random(10);
+    EEData[2] = Random(4);
+    AddNote(0, "EEPROM speed %u, time %u, status %u, %.3f Hz", EEData[0], EEData[1], EEData[2], Hz);
+    for(t = (200 + Random(2000)) * MS_NS; t + SEC_NS / 2 < StopTime; t += (30 + Random(2500)) * MS_NS)
+    {
+        Cmd = Commands[Random(sizeof(Commands))];
+        switch(Random(13))
+        {
+            case 6:
+            n = 1 + Random(0xFF);
+            AddNote(t, "NEC 0x%02X, address 0x%02X", Cmd, n);
+            t = NECFrame(t, n, Cmd, 0);
+            break;
+            case 7:
+            n = 1 + Random(24);
+            AddNote(t, "IR noise, %u pulses", n);
+            for(i = 0; i < n; i++)
+            {
+                AddEvent(t, IR_PIN_MASK, 0);
+                t += (100 + Random(6000)) * 1000ULL;
+                AddEvent(t, IR_PIN_MASK, 1);
+                t += (100 + Random(6000)) * 1000ULL;
+            }
+            break;
+            case 8:
+            case 9:
+            n = 80 + Random(420);                       // A step; the repeats hang on Delay2s()
+            Mask = Random(2) ? SW_UP_MASK : SW_DN_MASK;
+            AddNote(t, "%s switch, %u ms", Mask == SW_UP_MASK ? "Up" : "Down", n);
+            AddEvent(t, Mask, 0);
+            t += n * MS_NS;
+            AddEvent(t, Mask, 1);
+            break;
+            case 10:                                    // In class, the remote clock and the LED off
+            n = Random(6);
+            Clock = (int)Random(101) - 50;
+            Stretch = ((int)Random(71) - 30) * 1000;
+            AddNote(t, "NEC 0x%02X, %u repeats, clock %+.1f%%, marks %+d us", Cmd, n, Clock / 10.0, Stretch / 1000);
+            Start = t;
+            Jitter(Edges, k = NECEdges(Edges, 0x00, Cmd, 0), Clock, Stretch);
+            t = NECPlay(t, Edges, k);
+            for(i = 0; i < n; i++)
+            {
+                Jitter(Edges, k = NECEdges(Edges, 0x00, Cmd, 1), Clock, Stretch);
+                t = NECPlay(Start + (i + 1) * 108 * MS_NS * (1000 + Clock) / 1000, Edges, k);
+            }
+            break;
+            case 11:                                    // Out of class, an interval of a frame
+            k = NECEdges(Edges, 0x00, Cmd, 0);
+            n = 1 + Random(k - 2);                      // Not the stop bit, the frame ends in class
+            switch(Random(3))
+            {
+                case 0: Interval = (100 + Random(7900)) * 1000ULL; break;
+                case 1:                                 // The same LSB, 0.7 checks it alone
+                Interval = Edges[n] - Edges[n - 1] + (1 + Random(3)) * 256 * (SEC_NS / IR_CLOCK);
+                break;
+                default: Interval = (16 + Random(45)) * MS_NS; break;   // 16 ms, against bit 11 of 0.7
+            }
+            SetInterval(Edges, k, n, Interval);
+            AddNote(t, "NEC 0x%02X, interval %u of %llu us", Cmd, n, (unsigned long long)((Edges[n] - Edges[n - 1]) / 1000));
+            t = NECPlay(t, Edges, k);
+            break;
+            case 12:                                    // A frame cut short, the next one after a gap
+            n = 2 * (2 + Random(32));                   // Edges kept, the pin left high
+            i = 20 + Random(70);
+            AddNote(t, "NEC 0x%02X, cut after %u edges, again after %u ms", Cmd, n, i);
+            NECEdges(Edges, 0x00, Cmd, 0);
+            t = NECPlay(t, Edges, n);
+            t = NECFrame(t + i * MS_NS, 0x00, Cmd, 0);
+            break;
+            default:
+            n = Random(6);
+            AddNote(t, "NEC 0x%02X, %u repeats", Cmd, n);
+            Start = t;
+            t = NECFrame(t, 0x00, Cmd, 0);
+            for(i = 0; i < n; i++)
+                t = NECFrame(Start + (i + 1) * 108 * MS_NS, 0x00, Cmd, 1);
+        }
+    }
+    return Hz;
+}
+/**
+The stimuli moved off the decoder limits and the timer and zero cross collisions, that the
+lockstep does not check; -u leaves them where they fall, a divergence after one of them is
+explained by it
+*/
+static void ReportSteering(const uint64_t Moved[2])
+{
+    if(Unsteered)
+        printf("Steering         : off, the IR edges as generated\n");
+    else
+        printf("Steering         : %llu IR edges moved off a decoder limit, %llu NEC frames moved\n",
+               (unsigned long long)Moved[0], (unsigned long long)Moved[1]);
+}
+/**
+Run the scenarios, a process each and Jobs at a time. Returns the scenario in a child, the
+parent exits with the result
+*/
+static uint64_t RunScenarios(uint64_t First, uint64_t Runs, unsigned Jobs)
+{
+    uint64_t Next = First, Done = 0, Failed = 0, Moved[2] = {0, 0}, Got[3];
+    uint64_t Explained[HAZARD_COUNT] = {0}, Total = 0;
+    unsigned Running = 0, i;
+    int Exit;
+    pid_t Pid;
+
+    fflush(stdout);
+    if(pipe(StatsPipe) < 0 || fcntl(StatsPipe[0], F_SETFL, O_NONBLOCK) < 0)
+    {
+        perror("pipe");
+        exit(2);
+    }
+    while(Done < Runs)
+    {
+        while(Running < Jobs && Next < First + Runs)
+        {
+            if((Pid = fork()) < 0)
+            {
+                perror("fork");
+                exit(2);
+            }
+            if(Pid == 0)
+            {
+                setvbuf(stdout, NULL, _IOFBF, 1 << 16); // A report in one write
+                return Next;
+            }
+            Running++;
+            Next++;
+        }
+        if(wait(&Exit) < 0)
+            break;
+        Running--;
+        Done++;
+        if(!WIFEXITED(Exit) || WEXITSTATUS(Exit) != 0)
+            Failed++;
+        while(read(StatsPipe[0], Got, sizeof(Got)) == sizeof(Got))
+        {                                               // Written before the exit, a record is atomic
+            Moved[0] += Got[0];
+            Moved[1] += Got[1];
+            if(Got[2])                                  // The Cause, from 1
+            {
+                Explained[Got[2] - 1]++;
+                Total++;
+            }
+        }
+    }
+    printf("Scenarios        : %llu from %llu, %llu diverged, %llu explained, %llu failed\n", (unsigned long long)Done,
+           (unsigned long long)First, (unsigned long long)(Total + Failed), (unsigned long long)Total,
+           (unsigned long long)Failed);
+    ReportSteering(Moved);
+    printf("Explained        :");
+    for(i = 0; i < HAZARD_COUNT; i++)
+        printf("%s %s %llu", i ? "," : "", HazardName[i], (unsigned long long)Explained[i]);
+    printf("\n");
+    exit(Failed != 0);
+}
+
+static void Report(void)
+{
+    double Secs = Now / (double)SEC_NS;
+    unsigned i;
+
+#if defined IR_CAPTURE_INT
+    printf("IR capture       : INT, start of the marks\n");
+#else
+    printf("IR capture       : IOC, every edge\n");
+#endif
+#if defined _16F676
+    printf("Chip             : 16F676, %.0f MHz\n", _XTAL_FREQ / 1e6);
+#else
+    printf("Chip             : 12F675, %.0f MHz\n", _XTAL_FREQ / 1e6);
+#endif
+    printf("Time             : %.3f s\n", Secs);
+    printf("Interrupts       : %llu, %.0f/s (zero cross %llu, IR %llu, TMR0 %llu, Timer 1 polled %llu)\n",
+           (unsigned long long)IsrCount, IsrCount / Secs, (unsigned long long)ZcIsr,
+           (unsigned long long)IrIsr, (unsigned long long)T0Isr, (unsigned long long)Tmr1Isr);
+    printf("IR edges         : %llu, %llu frames and repeats sent", (unsigned long long)IrEdges, (unsigned long long)Frames);
+    if(IrEdges)
+        printf(", %.2f IR interrupts an edge", IrIsr / (double)IrEdges);
+    printf("\n");
+    if(DecodeEdges)
+    {
+        printf("IR decode        : %.1f cycles an edge, max %u (compares, model)", DecodeCycles / (double)DecodeEdges,
+               DecodeMax);
+#if !defined IR_CAPTURE_INT && _XTAL_FREQ == 4000000                   // The clock of the 0.7 timing
+        if(Protocol == PROTO_NEC)
+            printf(", 0.7 NECDecoder %.1f, max %u", OldCycles / (double)DecodeEdges, OldMax);
+#endif
+#if defined IR_RC5 || defined IR_SIRC
+        printf(", RC5/SIRC at the most");
+#endif
+        printf("\n                   class    edges  cycles\n");
+        for(i = 0; i <= PULSE_IDLE; i++)
+        {
+            if(ClassEdges[i])
+                printf("                   %-6s %7llu %7.1f\n", PulseName[i], (unsigned long long)ClassEdges[i],
+                       ClassCycles[i] / (double)ClassEdges[i]);
+        }
+    }
+    printf("Firing delay     : angle     n    mean(us)   min(us)   max(us)   p-p(us)  sd(us)\n");
+    for(i = 0; i < 256; i++)
+    {
+        FIRING *p = &Firing[i];
+        double Mean, Sd;
+        if(p->Count == 0)
+            continue;
+        Mean = p->Sum / p->Count;
+        Sd = sqrt(fmax(0.0, p->SumSq / p->Count - Mean * Mean));
+        printf("                   %5u %5llu  %9.1f %9.1f %9.1f %9.1f %7.2f\n", i, (unsigned long long)p->Count,
+               Mean, p->Min, p->Max, p->Max - p->Min, Sd);
+    }
+    printf("Per speed        : speed  mode   halves   int/s  TMR0/s  power(%%)  rms(%%)  gap(ms)  flicker(%%)\n");
+    for(i = 1; i < 10; i++)
+    {
+        SPEED_LOAD *p = &Load[i];
+        double Time;
+        if(p->Halves == 0)
+            continue;
+        Time = p->Halves * (double)HalfPeriod / SEC_NS;
+        printf("                   %5u  %-5s %7llu %7.0f %7.0f %9.1f %7.1f %8.0f", i, p->Burst ? "burst" : "phase",
+               (unsigned long long)p->Halves, p->Isrs / Time, p->T0s / Time, 100.0 * p->Power / p->Halves,
+               100.0 * sqrt(p->Power / p->Halves), p->MaxGap * (double)HalfPeriod / MS_NS);
+        if(p->Windows > 1)
+            printf(" %11.1f\n", 100.0 * (p->WinMax - p->WinMin));
+        else
+            printf(" %11s\n", "-");
+    }
+    printf("State            : Speed %u, Time %u, FanOn %u, TimerRunning %u, EEPROM writes %llu\n",
+           Speed, Time, FanOn, TimerRunning, (unsigned long long)EEWrites);
+}
+
+static void Usage(void)
+{
+    fprintf(stderr, "usage: sim [-t secs] [-f hz] [-c cmd] [-k n] [-p secs] [-i ir] [-n] [-e edges.txt] [-o secs]\n"
+                    "           [-s eeprom.bin] [-x hex [-z seed] [-r n] [-j n] [-w n] [-u]]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    double Secs = 20.0, Hz = 50.0, Offset = 3.0, Period = 1.0;
+    const char *EdgeFile = NULL, *volatile Snapshot = NULL, *HexFile = NULL;   // Kept over the longjmp()
+    unsigned char Cmds[32] = {0x55};
+    unsigned CmdCount = 1, Press = 0, Jobs = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+    char *p;
+    int c, Generate = 1, Keys = -1;
+    uint64_t t;
+    volatile uint64_t Runs = 0;
+
+    while((c = getopt(argc, argv, "t:f:c:k:p:ne:o:s:x:z:r:j:w:i:u")) != -1)
+    {
+        switch(c)
+        {
+            case 't': Secs = atof(optarg); break;
+            case 'f': Hz = atof(optarg); break;
+            case 'c':
+            for(CmdCount = 0, p = optarg; *p && CmdCount < sizeof(Cmds); p += (*p == ','))
+                Cmds[CmdCount++] = strtoul(p, &p, 0) & 0xFF;
+            if(CmdCount == 0)
+                Usage();
+            break;
+            case 'k': Keys = atoi(optarg); break;
+            case 'p': Period = atof(optarg); break;
+            case 'n': Generate = 0; break;
+            case 'e': EdgeFile = optarg; break;
+            case 'o': Offset = atof(optarg); break;
+            case 's': Snapshot = optarg; break;
+            case 'x': HexFile = optarg; break;
+            case 'z': ScenarioSeed = strtoull(optarg, NULL, 0); break;
+            case 'r': Runs = strtoull(optarg, NULL, 0); break;
+            case 'j': Jobs = atoi(optarg); break;
+            case 'w': Window = atoi(optarg); break;
+            case 'u': Unsteered = 1; break;
+            case 'i':
+            for(Protocol = 0; Protocol < PROTO_COUNT && strcmp(optarg, ProtoName[Protocol]); Protocol++)
+                ;
+            break;
+            default: Usage();
+        }
+    }
+    if(Secs <= 0.0 || Hz <= 0.0 || Period < 0.2 || Jobs == 0 || ((ScenarioSeed || Runs) && !HexFile))
+        Usage();
+    Lockstep = (HexFile != NULL);
+    if(Protocol == PROTO_COUNT || !ProtoBuilt(Protocol) || (Lockstep && Protocol != PROTO_NEC))
+    {
+        fprintf(stderr, "sim: -i takes nec, or samsung, rc5 and sirc built in with -DIR_SAMSUNG, -DIR_RC5 and\n"
+                        "     -DIR_SIRC; the lockstep takes nec\n");
+        return 2;
+    }
+#if defined IR_CAPTURE_INT || defined _16F676 || defined IR_RC5 || defined IR_SIRC || defined IR_SAMSUNG
+    if(Lockstep)
+    {
+        fprintf(stderr, "sim: lockstep needs the build of the 0.7 HEX (12F675, NEC, IR on the change interrupt)\n");
+        return 2;
+    }
+#endif
+    if(Lockstep && Pic14LoadHex(&Hex, HexFile) < 0)
+        return 1;
+    if(Runs)
+        ScenarioSeed = RunScenarios(ScenarioSeed ? ScenarioSeed : 1, Runs, Jobs);
+    StopTime = (uint64_t)(Secs * SEC_NS);
+    if(ScenarioSeed)
+    {
+        Hz = Scenario(ScenarioSeed);
+        memcpy(Hex.EE, EEData, PIC14_EE_SIZE);
+        Generate = 0;
+    }
+    HalfPeriod = (uint64_t)(SEC_NS / (2.0 * Hz));
+    NextZc = HalfPeriod;
+    NextTmr1 = (T1_START_CYCLES + 65536 * 8) * TCY_NS;
+
+    Pins = SW_UP_MASK | SW_DN_MASK | IR_PIN_MASK;       // Keys released, IR idle
+    if(Lockstep)
+    {
+        Hex.Pins = Pins;
+        Pic14Reset(&Hex, HEX_CLOCK);
+        HexZc = HalfPeriod;
+    }
+    if(EdgeFile && LoadEdges(EdgeFile, (uint64_t)(Offset * SEC_NS)) < 0)
+        return 1;
+    Steady = Lockstep && !Unsteered;                    // Edge lists are played as captured
+    if(Generate)                                        // Key presses, held for 4 repeats
+    {
+        for(t = 3 * SEC_NS; t < StopTime && Keys-- != 0; t += (uint64_t)(Period * SEC_NS), Press++)
+        {
+            KeyPress(t, Cmds[Press % CmdCount], Press);
+        }
+    }
+    qsort(Events, EventCount, sizeof(PIN_EVENT), CompareEvents);
+
+    if(setjmp(Stop) == 0)
+        FirmwareMain();
+    if(Runs)
+    {
+        uint64_t Record[3] = {Steered[0], Steered[1], (uint64_t)(Cause + 1)};
+
+        if(write(StatsPipe[1], Record, sizeof(Record)) != sizeof(Record))
+            perror("pipe");
+        return Diverged && Cause < 0;
+    }
+    Report();
+    if(Lockstep && !Diverged)
+        printf("Lockstep         : %llu half cycles, no divergence\n", (unsigned long long)Halves);
+    if(Lockstep)
+        ReportSteering(Steered);
+    if(Snapshot)
+    {
+        FILE *f = fopen(Snapshot, "wb");
+        if(f == NULL || fwrite(EEData, sizeof(EEData), 1, f) != 1)
+        {
+            perror(Snapshot);
+            return 1;
+        }
+        fclose(f);
+    }
+    return Diverged && Cause < 0;
+}
@@ -0,0 +1,428 @@
+/********************************************************************************
+*                   Speed Table Generator (host tool)                           *
+*                                                                               *
+*   This program is free software: you can redistribute it and/or modify        *
+*   it under the terms of the GNU General Public License as published by        *
+*   the Free Software Foundation, either version 3 of the License, or           *
+*   (at your option) any later version.                                         *
+*                                                                               *
+*   This program is distributed in the hope that it will be useful,             *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+*   GNU General Public License for more details.                                *
+*                                                                               *
+*   You should have received a copy of the GNU General Public License           *
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+*                                                                               *
+*       Processor       : Host PC (POSIX threads)                               *
+*                                                                               *
+*   Models the mains, the TRIAC (latch and holding current, snubber) and an     *
+*   inductive fan load, sweeps every TMR0 reload value in parallel and writes   *
+*   STable for each load class, with evenly spaced perceived speeds. The sweep  *
+*   runs on the 4 MHz TMR0 steps and the table holds the delays, so it builds   *
+*   for any clock.                                                              *
+*   The perceived speed is taken as the cube root of the delivered power (fan   *
+*   law). Speed 9 is fired the way isr() does it for full speed, with the gate  *
+*   held from the zero cross, all other speeds with the short T0IF pulse.       *
+*   Speeds 2-8 are spaced evenly over the usable firing points, the misfire     *
+*   bands between them left out; a step off the even step by more than          *
+*   STEP_TOLERANCE is reported, and the bands are listed in the header.         *
+*   The damping of the load while off (RING_DAMPING) is calibrated so that the  *
+*   points of the 0.7 table fire, as they do in use; one that misfires is       *
+*   reported. The header is written with CRLF line ends, as the sources.        *
+*   BTable holds the same power per speed as the part of the mains cycles       *
+*   conducted, for the burst fired speeds of BURST_FIRE in main.c.              *
+*                                                                               *
+*   Build   : cc -O2 -pthread -o stable stable.c -lm                            *
+*   Usage   : stable [-o ../src/stable.h] [-v volts] [-f hz] [-l min_power]     *
+*       -o  Output header, default stdout                                       *
+*       -v  Mains RMS voltage, default 230                                      *
+*       -f  Mains frequency, default 50                                         *
+*       -l  Power of speed 1 as a fraction of the full power, default 0.25      *
+*                                                                               *
+*********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// -- Firmware timing, see main() --
+#define XTAL_FREQ       4000000.0       // _XTAL_FREQ
+#define TMR0_PRESCALER  64              // OPTION = 0x05
+#define ISR_LATENCY     8e-6            // Zero cross edge to TMR0 load, and overflow to TriacOn()
+#define GATE_PULSE      7e-6            // GATE_US, from TriacOn() to TriacOff() at any clock
+
+// -- Model --
+#define STEP            1e-6            // Integration step
+#define SETTLE_CYCLES   6               // Mains cycles run before measuring
+#define MEASURE_CYCLES  2
+#define FULL_HOLD       0.97            // Held gate must deliver this part of the full power
+#define STEP_TOLERANCE  0.02            // A speed step further than this from the even step is reported
+#define SNUBBER_C       100e-9          // Snubber (or capacitive part of the load) across the TRIAC
+#define SNUBBER_R       100.0
+#define RING_DAMPING    1.0             // Damping ratio of the load and snubber ring while off, see main()
+
+typedef struct _LOAD
+{
+    const char *Name;                   // Name of the macro selecting the profile
+    const char *Description;
+    double      Power;                  // Rated power on a full sine, W
+    double      PowerFactor;
+    double      Latch, Hold;            // TRIAC latching and holding current, A
+    double      R, L;                   // Series model, worked out from the above
+    double      Ring;                   // Loss of the winding at the ring frequency, in series while off
+} LOAD;
+
+static LOAD Loads[] =
+{
+    {"LOAD_TABLE",   "50W table / pedestal fan",      50.0, 0.90, 0.025, 0.015, 0.0, 0.0, 0.0},
+    {"LOAD_CEILING", "75W ceiling fan",               75.0, 0.95, 0.025, 0.015, 0.0, 0.0, 0.0},
+    {"LOAD_EXHAUST", "120W exhaust / industrial fan", 120.0, 0.85, 0.025, 0.015, 0.0, 0.0, 0.0},
+};
+#define LOAD_COUNT  (sizeof(Loads) / sizeof(Loads[0]))
+
+typedef struct _POINT
+{
+    double Pulse;                       // Power with the short T0IF pulse, W
+    double Held;                        // Power with the gate held from the zero cross, W
+    int    PulseOk, HeldOk;             // Fired on every half cycle
+} POINT;
+
+// V A R I A B L E S
+static double Volts = 230.0, Hz = 50.0, MinPower = 0.25;
+static POINT Sweep[LOAD_COUNT][256];
+static const unsigned char Field[] = {157, 165, 173, 181, 188, 195, 205, 216};  // The 0.7 table, short pulse
+static unsigned NextJob;
+static pthread_mutex_t JobLock = PTHREAD_MUTEX_INITIALIZER;
+
+// F U N C T I O N S
+/**
+Delay from the zero cross to the T0IF firing for a TMR0 reload value
+*/
+static double FiringDelay(unsigned Tmr0)
+{
+    return (256 - Tmr0) * TMR0_PRESCALER * 4.0 / XTAL_FREQ + ISR_LATENCY;
+}
+/**
+Run the circuit to a steady state and return the mean power in the load resistance.
+The gate is on from GateOn to GateOff (seconds after each zero cross), a GateOn past the
+next zero cross never fires, as the zero cross reloads TMR0 first. Ok is cleared if the
+TRIAC failed to stay on after the gate on any measured half cycle (half wave or misfire)
+*/
+static double Simulate(const LOAD *Load, double GateOn, double GateOff, int *Ok)
+{
+    double Half = 0.5 / Hz, Vpk = Volts * sqrt(2.0), w = 2.0 * M_PI * Hz;
+    double i = 0.0, Vc = 0.0, Energy = 0.0, t;
+    long n, Steps = (long)((SETTLE_CYCLES + MEASURE_CYCLES) / Hz / STEP);
+    long Measure = (long)(SETTLE_CYCLES / Hz / STEP);
+    int On = 0, Latched = 0, Fired = 0;
+
+    for(n = 0; n < Steps; n++)
+    {
+        double v, Phase, Itriac;
+        int Gate;
+
+        t = n * STEP;
+        v = Vpk * sin(w * t);
+        Phase = fmod(t, Half);
+        if(Phase < STEP)                                // A new half cycle
+        {
+            if(n > Measure && GateOn < Half && !Fired)
+                *Ok = 0;
+            Fired = 0;
+        }
+        Gate = GateOn < Half && Phase >= GateOn && Phase < GateOff;
+        if(Gate && !On)
+        {
+            On = 1;                                     // Fired, latched only if the current builds up in time
+            Latched = 0;
+        }
+        if(On)
+        {                                               // Node at the TRIAC is held at zero
+            Itriac = i + Vc / SNUBBER_R;
+            if(fabs(Itriac) >= Load->Latch)
+                Latched = 1;
+            if(!Gate && fabs(Itriac) < (Latched ? Load->Hold : Load->Latch))
+                On = 0;                                 // Dropped out
+            else if(Phase > (GateOff + Half) / 2.0 && Itriac * v > 0.0)
+                Fired = 1;                              // Still on for this half cycle, well after the gate
+        }
+        if(On)
+        {
+            i += (v - Load->R * i) / Load->L * STEP;
+            Vc += -Vc / (SNUBBER_R * SNUBBER_C) * STEP;
+        }
+        else
+        {                                               // Only the snubber leaks through the load
+            i += (v - (Load->R + SNUBBER_R + Load->Ring) * i - Vc) / Load->L * STEP;
+            Vc += i / SNUBBER_C * STEP;
+        }
+        if(n >= Measure)
+            Energy += i * i * Load->R * STEP;
+    }
+    return Energy / (MEASURE_CYCLES / Hz);
+}
+/**
+Worker, takes the next (load, TMR0) pair until the sweep is done
+*/
+static void *Worker(void *Arg)
+{
+    unsigned Job;
+
+    (void)Arg;
+    for(;;)
+    {
+        pthread_mutex_lock(&JobLock);
+        Job = NextJob++;
+        pthread_mutex_unlock(&JobLock);
+        if(Job >= LOAD_COUNT * 256)
+            break;
+        {
+            const LOAD *Load = &Loads[Job / 256];
+            unsigned Tmr0 = Job % 256;
+            double Fire = FiringDelay(Tmr0);
+            POINT *Point = &Sweep[Job / 256][Tmr0];
+            Point->PulseOk = Point->HeldOk = 1;
+            Point->Pulse = Simulate(Load, Fire, Fire + GATE_PULSE, &Point->PulseOk);
+            Point->Held = Simulate(Load, ISR_LATENCY, Fire + GATE_PULSE, &Point->HeldOk);
+        }
+    }
+    return NULL;
+}
+/**
+Power with the gate on all the time, the reference for full speed
+*/
+static double FullPower(const LOAD *Load)
+{
+    int Ok;
+    return Simulate(Load, 0.0, 1.0, &Ok);
+}
+/**
+A short pulse firing point is usable if it and its neighbours fire on every half cycle,
+one count either side covers the spread of the components
+*/
+static int Usable(unsigned l, unsigned p)
+{
+    return Sweep[l][p].PulseOk && (p == 0 || Sweep[l][p - 1].PulseOk) && (p == 255 || Sweep[l][p + 1].PulseOk);
+}
+/**
+Pick the table for a load from the sweep. Speed 1 is the first usable point with MinPower,
+speed 9 the shortest held gate at full power. Speeds 2-8 are spaced evenly along the
+usable points between them, with the misfire bands taken out, so each step stays within a
+usable segment and a band costs one larger step instead of bunching the speeds. Returns 0
+if there are too few usable points
+*/
+static int MakeTable(unsigned l, unsigned char Table[10], double Speed[10])
+{
+    double Full = FullPower(&Loads[l]), Along[256], Length, Target, Best;
+    unsigned k, p, Last;
+
+    Table[0] = 0;
+    Speed[0] = 0.0;
+    for(p = 255; p > 1; p--)                            // Shortest hold that still runs at full power
+    {
+        if(Sweep[l][p].HeldOk && Sweep[l][p - 1].HeldOk && Sweep[l][p].Held >= FULL_HOLD * Full)
+            break;
+    }
+    Table[9] = p - 1;                                   // One count margin for the component spread
+    Speed[9] = cbrt(Sweep[l][Table[9]].Held / Full);
+    for(p = 0; p < Table[9] && !(Usable(l, p) && Sweep[l][p].Pulse >= MinPower * Full); p++)
+        ;
+    Table[1] = p;
+    Speed[1] = cbrt(Sweep[l][p].Pulse / Full);
+    Length = 0.0;                                       // Distance in speed along the usable points
+    for(Last = p, Along[p] = 0.0, p++; p < Table[9]; p++)
+    {
+        if(!Usable(l, p))
+            continue;
+        if(p == Last + 1)                               // A band between does not count
+            Length += cbrt(Sweep[l][p].Pulse / Full) - cbrt(Sweep[l][Last].Pulse / Full);
+        Along[p] = Length;
+        Last = p;
+    }
+    if(Last + 1 == Table[9])
+        Length += Speed[9] - cbrt(Sweep[l][Last].Pulse / Full);
+    for(k = 2; k < 9; k++)
+    {
+        Target = Length * (k - 1) / 8.0;
+        Best = 2.0;
+        Table[k] = 0;
+        for(p = Table[k - 1] + 1; p < Table[9]; p++)
+        {
+            unsigned Left, q;
+            if(!Usable(l, p) || fabs(Along[p] - Target) >= Best)
+                continue;
+            for(Left = 0, q = p + 1; q < Table[9]; q++) // Keep a point for each speed above
+                Left += Usable(l, q);
+            if(Left < 8 - k)
+                break;
+            Best = fabs(Along[p] - Target);
+            Table[k] = p;
+        }
+        if(Table[k] == 0)
+            return 0;
+        Speed[k] = cbrt(Sweep[l][Table[k]].Pulse / Full);
+    }
+    for(k = 2; k < 10; k++)
+    {
+        Target = (Speed[9] - Speed[1]) / 8.0;
+        if(fabs(Speed[k] - Speed[k - 1] - Target) > STEP_TOLERANCE)
+            fprintf(stderr, "stable: %s speed %u to %u is a %.1f%% step, the even step is %.1f%%\n",
+                    Loads[l].Name, k - 1, k, (Speed[k] - Speed[k - 1]) * 100.0, Target * 100.0);
+    }
+    return 1;
+}
+static void Put(FILE *Out, const char *Format, ...);
+/**
+List the misfire bands between speed 1 and full speed in the header
+*/
+static void PrintBands(FILE *Out, unsigned l, const unsigned char Table[10])
+{
+    unsigned p, From;
+
+    for(p = Table[1]; p < Table[9]; p++)
+    {
+        if(Sweep[l][p].PulseOk)
+            continue;
+        for(From = p; p + 1 < Table[9] && !Sweep[l][p + 1].PulseOk; p++)
+            ;
+        Put(Out, "// Misfires from TMR0 %u to %u, left out with a count either side\n", From, p);
+    }
+}
+
+/**
+fprintf() to the header, with CRLF line ends as the sources in src/
+*/
+static void Put(FILE *Out, const char *Format, ...)
+{
+    char Text[256], *p;
+    va_list Args;
+
+    va_start(Args, Format);
+    vsnprintf(Text, sizeof(Text), Format, Args);
+    va_end(Args);
+    for(p = Text; *p; p++)
+    {
+        if(*p == '\n')
+            fputc('\r', Out);
+        fputc(*p, Out);
+    }
+}
+
+static void Usage(void)
+{
+    fprintf(stderr, "usage: stable [-o stable.h] [-v volts] [-f hz] [-l min_power]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *Out = stdout;
+    char Line[80];
+    pthread_t *Threads;
+    long Cores;
+    unsigned l, k;
+    int c;
+
+    while((c = getopt(argc, argv, "o:v:f:l:")) != -1)
+    {
+        switch(c)
+        {
+            case 'o':
+            if((Out = fopen(optarg, "wb")) == NULL)
+            {
+                perror(optarg);
+                return 1;
+            }
+            break;
+            case 'v': Volts = atof(optarg); break;
+            case 'f': Hz = atof(optarg); break;
+            case 'l': MinPower = atof(optarg); break;
+            default: Usage();
+        }
+    }
+    if(Volts <= 0.0 || Hz <= 0.0 || MinPower <= 0.0 || MinPower >= 1.0)
+        Usage();
+    // Series R-L from the rating. The 50 Hz fit leaves out the eddy and core loss of the winding,
+    // which damps its ring with the snubber (some 450 Hz) while the TRIAC is off. Undamped, the
+    // ring moved the current at the firing point and gave misfire bands where the 0.7 table
+    // fires in use (TMR0 199-213 on LOAD_TABLE); critically damped, all of Field[] fires
+    for(l = 0; l < LOAD_COUNT; l++)
+    {
+        double Z = Volts * Volts * Loads[l].PowerFactor / Loads[l].Power;
+        Loads[l].R = Z * Loads[l].PowerFactor;
+        Loads[l].L = Z * sin(acos(Loads[l].PowerFactor)) / (2.0 * M_PI * Hz);
+        Loads[l].Ring = fmax(0.0, 2.0 * RING_DAMPING * sqrt(Loads[l].L / SNUBBER_C) - Loads[l].R - SNUBBER_R);
+    }
+
+    Cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if(Cores < 1)
+        Cores = 1;
+    Threads = calloc(Cores, sizeof(pthread_t));
+    for(k = 0; k < Cores; k++)
+        pthread_create(&Threads[k], NULL, Worker, NULL);
+    for(k = 0; k < Cores; k++)
+        pthread_join(Threads[k], NULL);
+    free(Threads);
+
+    Put(Out, "/********************************************************************************\n");
+    Put(Out, "*   Speed tables, generated by tools/stable.c - do not edit                     *\n");
+    snprintf(Line, sizeof(Line), "*   Mains %.0fV %.0fHz, TMR0 1:%d at %.0fMHz, speed 1 at %.0f%% power or more",
+             Volts, Hz, TMR0_PRESCALER, XTAL_FREQ / 1e6, MinPower * 100.0);
+    Put(Out, "%-79s*\n", Line);
+    Put(Out, "*   Entries are TMR0 delays in us, PHASE_ANGLE() in main.c sets them for the    *\n");
+    Put(Out, "*   clock. Select one with LOAD_PROFILE in main.c. BTable is the power of the   *\n");
+    Put(Out, "*   speeds in %% for BURST_FIRE, full speed is always on the phase angle         *\n");
+    Put(Out, "*********************************************************************************/\n");
+    Put(Out, "#define STABLE_MAINS    %.0f\n", Hz);                // The delays hold for this mains only
+    Put(Out, "#if MAINS_FREQ != STABLE_MAINS\n#error \"stable.h is for other mains, run tools/stable -f\"\n#endif\n");
+    for(l = 0; l < LOAD_COUNT; l++)
+        Put(Out, "#define %-16s%u\n", Loads[l].Name, l + 1);
+    for(l = 0; l < LOAD_COUNT; l++)
+    {
+        unsigned char Table[10];
+        double Speed[10], Full = FullPower(&Loads[l]);
+
+        if(!MakeTable(l, Table, Speed))
+        {
+            fprintf(stderr, "stable: %s has too few usable firing points for 9 speeds\n", Loads[l].Name);
+            return 1;
+        }
+        for(k = 0; k < sizeof(Field); k++)              // Calibration, the points fans fire on in use
+        {
+            if(!Usable(l, Field[k]))
+                fprintf(stderr, "stable: %s misfires at TMR0 %u of the 0.7 table, check RING_DAMPING\n",
+                        Loads[l].Name, Field[k]);
+        }
+        Put(Out, "\n%s LOAD_PROFILE == %s\n", l == 0 ? "#if" : "#elif", Loads[l].Name);
+        Put(Out, "// %s, pf %.2f, TRIAC latch %.0fmA hold %.0fmA, speed 1 at %.0f%% power\n",
+                Loads[l].Description, Loads[l].PowerFactor, Loads[l].Latch * 1e3, Loads[l].Hold * 1e3,
+                Speed[1] * Speed[1] * Speed[1] * 100.0);
+        PrintBands(Out, l, Table);
+        Put(Out, "// Speed  TMR0  Delay(us)  Power(W)  Speed(%%)\n");
+        for(k = 1; k < 10; k++)
+            Put(Out, "//   %u    %3u     %5.0f     %5.1f     %5.1f\n", k, Table[k],
+                    FiringDelay(Table[k]) * 1e6, Speed[k] * Speed[k] * Speed[k] * Full, Speed[k] * 100.0);
+        Put(Out, "#define PHASE_LONGEST   %.0f\n", (256 - Table[1]) * TMR0_PRESCALER * 4e6 / XTAL_FREQ);
+        Put(Out, "#define PHASE_SHORTEST  %.0f\n", (256 - Table[9]) * TMR0_PRESCALER * 4e6 / XTAL_FREQ);
+        Put(Out, "const unsigned char STable[10] = {0,");      // As TMR0 delays, for any clock
+        for(k = 1; k < 10; k++)                                 // main.c checks the ends fit TMR0
+            if(k == 1 || k == 9)
+                Put(Out, "%sPHASE_ANGLE(%s)%s", k % 5 == 1 ? "\n    " : " ",
+                        k == 1 ? "PHASE_LONGEST" : "PHASE_SHORTEST", k < 9 ? "," : "};\n");
+            else
+                Put(Out, "%sPHASE_ANGLE(%.0f),", k % 5 == 1 ? "\n    " : " ",
+                        (256 - Table[k]) * TMR0_PRESCALER * 4e6 / XTAL_FREQ);
+        Put(Out, "#if defined BURST_FIRE\nconst unsigned char BTable[10] = {0,");
+        for(k = 1; k < 9; k++)                                  // Power of the speed, of full
+            Put(Out, "%sBURST_POWER(%.0f),", k % 5 == 1 ? "\n    " : " ", Speed[k] * Speed[k] * Speed[k] * 100.0);
+        Put(Out, " 0};\n#endif\n");
+    }
+    Put(Out, "#else\n#error \"Unknown LOAD_PROFILE\"\n#endif\n");
+    if(Out != stdout)
+        fclose(Out);
+    return 0;
+}
@@ -0,0 +1,173 @@
+/********************************************************************************
+*                   Usage Counter Reader (host tool)                            *
+*                                                                               *
+*   This program is free software: you can redistribute it and/or modify        *
+*   it under the terms of the GNU General Public License as published by        *
+*   the Free Software Foundation, either version 3 of the License, or           *
+*   (at your option) any later version.                                         *
+*                                                                               *
+*   This program is distributed in the hope that it will be useful,             *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+*   GNU General Public License for more details.                                *
+*                                                                               *
+*   You should have received a copy of the GNU General Public License           *
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+*                                                                               *
+*       Processor       : Host PC                                               *
+*                                                                               *
+*   Prints the settings and the usage counters (src/usage.h) of a fan from an   *
+*   EEPROM dump: an Intel HEX file as read by the programmer, or a raw image    *
+*   such as the one written by the simulator (sim -s).                          *
+*                                                                               *
+*   Build   : cc -O2 -I../src -o usage usage.c                                  *
+*   Usage   : usage [-a addr] [-w step] eeprom.hex|eeprom.bin                   *
+*       -a  Byte address of the EEPROM in a HEX file, default 0x4200            *
+*       -w  Bytes between the EEPROM cells in a HEX file, default 2 (a word)    *
+*                                                                               *
+*********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usage.h"
+
+#define EE_SIZE         128
+
+static unsigned char EEData[EE_SIZE];
+static unsigned char EEValid[EE_SIZE];
+static unsigned long HexBase = 0x4200, HexStep = 2;
+
+static const char *CountName[USAGE_COUNTS] = {"Fan starts", "Timer expiries", "IR frames", "IR rejects",
+    "Unknown commands"};
+/**
+Read an Intel HEX file, keeping the EEPROM cells
+*/
+static int ReadHex(FILE *f)
+{
+    char Line[600];
+    unsigned long Upper = 0, Address;
+    unsigned Count, Offset, Type, Byte, Sum, i;
+
+    while(fgets(Line, sizeof(Line), f))
+    {
+        if(Line[0] != ':')
+            continue;
+        if(sscanf(Line + 1, "%2x%4x%2x", &Count, &Offset, &Type) != 3 || strlen(Line) < 11 + Count * 2)
+            return -1;
+        Sum = Count + (Offset >> 8) + (Offset & 0xFF) + Type;
+        for(i = 0; i <= Count; i++)
+        {
+            sscanf(Line + 9 + i * 2, "%2x", &Byte);
+            Sum += Byte;
+            if(i == Count)
+                break;
+            Address = Upper + Offset + i;
+            if(Type == 0 && Address >= HexBase && (Address - HexBase) % HexStep == 0 &&
+               (Address - HexBase) / HexStep < EE_SIZE)
+            {
+                EEData[(Address - HexBase) / HexStep] = Byte;
+                EEValid[(Address - HexBase) / HexStep] = 1;
+            }
+        }
+        if(Sum & 0xFF)
+            return -1;
+        if(Type == 4 && Count == 2)
+        {
+            sscanf(Line + 9, "%4lx", &Upper);
+            Upper <<= 16;
+        }
+        if(Type == 1)
+            break;
+    }
+    return 0;
+}
+/**
+Little endian counter of Size bytes
+*/
+static unsigned long Counter(unsigned Address, unsigned Size)
+{
+    unsigned long Value = 0;
+
+    while(Size-- != 0)
+        Value = Value << 8 | EEData[Address + Size];
+    return Value;
+}
+
+static void Usage(void)
+{
+    fprintf(stderr, "usage: usage [-a addr] [-w step] eeprom.hex|eeprom.bin\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f;
+    unsigned long Minutes, Total = 0, Frames, Rejects;
+    unsigned i;
+    int c;
+
+    while((c = getopt(argc, argv, "a:w:")) != -1)
+    {
+        switch(c)
+        {
+            case 'a': HexBase = strtoul(optarg, NULL, 0); break;
+            case 'w': HexStep = strtoul(optarg, NULL, 0); break;
+            default: Usage();
+        }
+    }
+    if(optind != argc - 1 || HexStep == 0)
+        Usage();
+    if((f = fopen(argv[optind], "rb")) == NULL)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    c = fgetc(f);
+    rewind(f);
+    if(c == ':')
+    {
+        if(ReadHex(f) < 0)
+        {
+            fprintf(stderr, "%s: bad HEX record\n", argv[optind]);
+            return 1;
+        }
+    }
+    else
+    {
+        memset(EEValid, fread(EEData, 1, EE_SIZE, f) == EE_SIZE, EE_SIZE);
+    }
+    fclose(f);
+    for(i = 0; i <= EE_USAGE_VERSION; i++)
+    {
+        if(!EEValid[i])
+        {
+            fprintf(stderr, "%s: no EEPROM data at 0x%02X\n", argv[optind], i);
+            return 1;
+        }
+    }
+    if(EEData[EE_USAGE_VERSION] != USAGE_VERSION)
+    {
+        fprintf(stderr, "%s: usage layout %u, expected %u\n", argv[optind], EEData[EE_USAGE_VERSION], USAGE_VERSION);
+        return 1;
+    }
+
+    printf("Settings         : speed %u, timer %u h, fan %s, timer %s\n", EEData[0], EEData[1],
+           EEData[2] & 0x01 ? "on" : "off", EEData[2] & 0x02 ? "running" : "off");
+    printf("Run time         :");
+    for(i = 1; i <= 9; i++)
+    {
+        Minutes = Counter(EE_RUN_MINUTES + (i - 1) * 3, 3);
+        Total += Minutes;
+        printf("%s speed %u %5lu:%02lu h", i == 1 ? "" : "\n                  ", i, Minutes / 60, Minutes % 60);
+    }
+    printf("\n                   total   %5lu:%02lu h\n", Total / 60, Total % 60);
+    for(i = 0; i < USAGE_COUNTS; i++)
+        printf("%-17s: %lu\n", CountName[i], Counter(EE_COUNTS + i * 2, 2));
+    Frames = Counter(EE_COUNTS + USAGE_IR_FRAMES * 2, 2);
+    Rejects = Counter(EE_COUNTS + USAGE_IR_REJECTS * 2, 2);
+    if(Frames + Rejects)
+        printf("IR reject rate   : %.1f%%\n", Rejects * 100.0 / (Frames + Rejects));
+    printf("Settings writes  : %lu\n", Counter(EE_WRITES, 2));
+    return 0;
+}